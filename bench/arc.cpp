@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stl/arc.hpp>
+#include <stl/rc.hpp>
+#include <stl/sharded_arc.hpp>
+
+#include "bench.hpp"
+
+namespace {
+
+using element = std::uint64_t;
+
+struct stl_arc {
+  using pointer = stl::arc<element>;
+  using weak = stl::weak_arc<element>;
+
+  static auto make(element value) -> pointer {
+    return stl::make_arc<element>(value);
+  }
+};
+
+struct stl_pooled_arc {
+  using pointer = stl::arc<element>;
+  using weak = stl::weak_arc<element>;
+
+  static auto make(element value) -> pointer {
+    return stl::make_pooled_arc<element>(value);
+  }
+};
+
+struct stl_sharded_arc {
+  using pointer = stl::sharded_arc<element>;
+
+  static auto make(element value) -> pointer {
+    return stl::make_sharded_arc<element>(value);
+  }
+};
+
+struct stl_rc {
+  using pointer = stl::rc<element>;
+  using weak = stl::weak_rc<element>;
+
+  static auto make(element value) -> pointer {
+    return stl::make_rc<element>(value);
+  }
+};
+
+struct std_arc {
+  using pointer = std::shared_ptr<element>;
+  using weak = std::weak_ptr<element>;
+
+  static auto make(element value) -> pointer {
+    return std::make_shared<element>(value);
+  }
+};
+
+template <typename Pointers>
+auto make(stl::bench::state& state) -> void {
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    auto object = Pointers::make(i);
+    stl::bench::do_not_optimize(object.get());
+  }
+}
+
+// Replaces one of window live objects per iteration, so that frees land in
+// a different order than the allocations, as with messages in flight.
+template <typename Pointers>
+auto churn(stl::bench::state& state) -> void {
+  constexpr std::size_t window = 256;
+  std::vector<typename Pointers::pointer> live;
+  for (std::size_t i = 0; i < window; ++i) {
+    live.push_back(Pointers::make(i));
+  }
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    live[(i * 97) % window] = Pointers::make(i);
+    stl::bench::do_not_optimize(live.data());
+  }
+}
+
+// One increment and one decrement of an uncontended count.
+template <typename Pointers>
+auto copy(stl::bench::state& state) -> void {
+  auto object = Pointers::make(1);
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    auto copy = object;
+    stl::bench::do_not_optimize(copy.get());
+  }
+}
+
+// Hands out fan_out copies and drops them again, as a node publishing to
+// its subscribers would. Holding the copies keeps the compiler from pairing
+// up and deleting the increments and decrements of a non-atomic count.
+template <typename Pointers>
+auto fan_out(stl::bench::state& state) -> void {
+  constexpr std::size_t fan_out = 64;
+  auto object = Pointers::make(1);
+  std::vector<typename Pointers::pointer> copies;
+  copies.reserve(fan_out);
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    for (std::size_t j = 0; j < fan_out; ++j) {
+      copies.push_back(object);
+    }
+    stl::bench::do_not_optimize(copies.data());
+    copies.clear();
+  }
+  state.counter("copies_per_iter", fan_out);
+}
+
+template <typename Pointers>
+auto lock(stl::bench::state& state) -> void {
+  auto object = Pointers::make(1);
+  typename Pointers::weak observer(object);
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    auto locked = observer.lock();
+    stl::bench::do_not_optimize(locked.get());
+  }
+}
+
+// Every thread copies and drops the same pointer, as threads reading a
+// global would. Reports wall time per copy on each thread, which stays flat
+// as threads are added only if the count does not bounce between cores.
+template <typename Pointers>
+auto contended_copy(std::size_t threads) {
+  return [threads](stl::bench::state& state) {
+    auto object = Pointers::make(1);
+    std::atomic<std::size_t> ready{0};
+    auto work = [&] {
+      ready.fetch_add(1, std::memory_order_relaxed);
+      while (ready.load(std::memory_order_relaxed) < threads) {
+      }
+      for (std::size_t i = 0; i < state.iterations(); ++i) {
+        auto copy = object;
+        stl::bench::do_not_optimize(copy.get());
+      }
+    };
+    std::vector<std::thread> workers;
+    for (std::size_t t = 1; t < threads; ++t) {
+      workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    state.counter("threads", static_cast<double>(threads));
+  };
+}
+
+STL_BENCHMARK("arc/make/u64/stl", make<stl_arc>);
+STL_BENCHMARK("arc/make/u64/std", make<std_arc>);
+STL_BENCHMARK("arc/make/u64/rc", make<stl_rc>);
+STL_BENCHMARK("arc/make/u64/pooled", make<stl_pooled_arc>);
+STL_BENCHMARK("arc/churn/u64/stl", churn<stl_arc>);
+STL_BENCHMARK("arc/churn/u64/std", churn<std_arc>);
+STL_BENCHMARK("arc/churn/u64/pooled", churn<stl_pooled_arc>);
+STL_BENCHMARK("arc/copy/u64/stl", copy<stl_arc>);
+STL_BENCHMARK("arc/copy/u64/std", copy<std_arc>);
+STL_BENCHMARK("arc/copy/u64/rc", copy<stl_rc>);
+STL_BENCHMARK("arc/fan_out/u64/stl", fan_out<stl_arc>);
+STL_BENCHMARK("arc/fan_out/u64/std", fan_out<std_arc>);
+STL_BENCHMARK("arc/fan_out/u64/rc", fan_out<stl_rc>);
+STL_BENCHMARK("arc/weak_lock/u64/stl", lock<stl_arc>);
+STL_BENCHMARK("arc/weak_lock/u64/std", lock<std_arc>);
+STL_BENCHMARK("arc/weak_lock/u64/rc", lock<stl_rc>);
+STL_BENCHMARK("arc/copy/u64/sharded", copy<stl_sharded_arc>);
+
+const bool registered = [] {
+  std::size_t hardware =
+      std::max<std::size_t>(2, std::thread::hardware_concurrency());
+  for (std::size_t threads = 1; threads <= std::min<std::size_t>(hardware, 64);
+       threads *= 2) {
+    auto suffix = "/" + std::to_string(threads);
+    stl::bench::registration("arc/contended_copy/u64/stl" + suffix,
+                             contended_copy<stl_arc>(threads));
+    stl::bench::registration("arc/contended_copy/u64/std" + suffix,
+                             contended_copy<std_arc>(threads));
+    stl::bench::registration("arc/contended_copy/u64/sharded" + suffix,
+                             contended_copy<stl_sharded_arc>(threads));
+  }
+  return true;
+}();
+
+}  // namespace
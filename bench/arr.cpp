@@ -0,0 +1,73 @@
+#include <array>
+#include <cstdint>
+
+#include <stl/arr.hpp>
+
+#include "bench.hpp"
+
+namespace {
+
+using element = std::uint64_t;
+
+constexpr std::size_t length = 256;
+
+template <typename Array>
+auto fill(stl::bench::state& state) -> void {
+  Array values;
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    values.fill(static_cast<element>(i));
+    stl::bench::do_not_optimize(values.data());
+  }
+}
+
+template <typename Array>
+auto copy(stl::bench::state& state) -> void {
+  Array source;
+  source.fill(1);
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    stl::bench::clobber_memory();
+    Array values = source;
+    stl::bench::do_not_optimize(values.data());
+  }
+}
+
+template <typename Array>
+auto compare(stl::bench::state& state) -> void {
+  Array lhs;
+  Array rhs;
+  lhs.fill(1);
+  rhs.fill(1);
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    stl::bench::clobber_memory();
+    bool equal = lhs == rhs;
+    stl::bench::do_not_optimize(equal);
+  }
+}
+
+template <typename Array>
+auto sum(stl::bench::state& state) -> void {
+  Array values;
+  values.fill(1);
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    stl::bench::clobber_memory();
+    element total = 0;
+    for (element value : values) {
+      total += value;
+    }
+    stl::bench::do_not_optimize(total);
+  }
+}
+
+using stl_array = stl::arr<element, length>;
+using std_array = std::array<element, length>;
+
+STL_BENCHMARK("arr/fill/u64x256/stl", fill<stl_array>);
+STL_BENCHMARK("arr/fill/u64x256/std", fill<std_array>);
+STL_BENCHMARK("arr/copy/u64x256/stl", copy<stl_array>);
+STL_BENCHMARK("arr/copy/u64x256/std", copy<std_array>);
+STL_BENCHMARK("arr/compare/u64x256/stl", compare<stl_array>);
+STL_BENCHMARK("arr/compare/u64x256/std", compare<std_array>);
+STL_BENCHMARK("arr/sum/u64x256/stl", sum<stl_array>);
+STL_BENCHMARK("arr/sum/u64x256/std", sum<std_array>);
+
+}  // namespace
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace stl::bench {
+
+using clock = std::chrono::steady_clock;
+
+// Per-run handle passed to a benchmark body. The body performs iterations()
+// repetitions of the measured operation; the harness times the call from its
+// start, or from the last reset_timer() so that setup can be excluded, and
+// reports the mean. Extra measurements can be attached as counters.
+class state {
+ public:
+  explicit state(std::size_t iterations)
+      : _iterations(iterations), _start(clock::now()) {}
+
+  auto iterations() const noexcept -> std::size_t {
+    return _iterations;
+  }
+
+  auto reset_timer() noexcept -> void {
+    _start = clock::now();
+  }
+
+  auto start() const noexcept -> clock::time_point {
+    return _start;
+  }
+
+  auto counter(std::string name, double value) -> void {
+    for (auto& [key, current] : _counters) {
+      if (key == name) {
+        current = value;
+        return;
+      }
+    }
+    _counters.emplace_back(std::move(name), value);
+  }
+
+  auto counters() const noexcept
+      -> const std::vector<std::pair<std::string, double>>& {
+    return _counters;
+  }
+
+ private:
+  std::size_t _iterations;
+  clock::time_point _start;
+  std::vector<std::pair<std::string, double>> _counters;
+};
+
+struct benchmark {
+  std::string name;
+  std::function<void(state&)> body;
+};
+
+inline auto registry() -> std::vector<benchmark>& {
+  static std::vector<benchmark> benchmarks;
+  return benchmarks;
+}
+
+struct registration {
+  registration(std::string name, std::function<void(state&)> body) {
+    registry().push_back({std::move(name), std::move(body)});
+  }
+};
+
+// Keeps the optimizer from discarding a value that is otherwise unused.
+template <typename T>
+inline auto do_not_optimize(T&& value) -> void {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline auto clobber_memory() -> void {
+  asm volatile("" : : : "memory");
+}
+
+inline auto elapsed_ns(clock::time_point start) -> double {
+  return std::chrono::duration<double, std::nano>(clock::now() - start)
+      .count();
+}
+
+}  // namespace stl::bench
+
+#define STL_BENCH_CONCAT_IMPL(a, b) a##b
+#define STL_BENCH_CONCAT(a, b) STL_BENCH_CONCAT_IMPL(a, b)
+
+// Registers body, a callable taking stl::bench::state&, under name.
+#define STL_BENCHMARK(name, body)                          \
+  static ::stl::bench::registration STL_BENCH_CONCAT(      \
+      stl_bench_registration_, __LINE__)(name, body)
@@ -0,0 +1,65 @@
+#include <cstdint>
+#include <memory>
+
+#include <stl/box.hpp>
+
+#include "bench.hpp"
+
+namespace {
+
+using element = std::uint64_t;
+
+// Wraps the two factories so the benchmarks below can be written once.
+struct stl_box {
+  template <typename T>
+  static auto make(element value) {
+    return stl::make_box<T>(value);
+  }
+};
+
+struct std_box {
+  template <typename T>
+  static auto make(element value) {
+    return std::make_unique<T>(value);
+  }
+};
+
+template <typename Factory>
+auto make(stl::bench::state& state) -> void {
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    auto object = Factory::template make<element>(i);
+    stl::bench::do_not_optimize(object.get());
+  }
+}
+
+// Passes ownership down a chain of moves, as a pipeline handing off a
+// buffer between stages would.
+template <typename Factory>
+auto move(stl::bench::state& state) -> void {
+  auto object = Factory::template make<element>(1);
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    auto next = std::move(object);
+    stl::bench::do_not_optimize(next.get());
+    object = std::move(next);
+  }
+}
+
+template <typename Factory>
+auto deref(stl::bench::state& state) -> void {
+  auto object = Factory::template make<element>(1);
+  element total = 0;
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    stl::bench::clobber_memory();
+    total += *object;
+  }
+  stl::bench::do_not_optimize(total);
+}
+
+STL_BENCHMARK("box/make/u64/stl", make<stl_box>);
+STL_BENCHMARK("box/make/u64/std", make<std_box>);
+STL_BENCHMARK("box/move/u64/stl", move<stl_box>);
+STL_BENCHMARK("box/move/u64/std", move<std_box>);
+STL_BENCHMARK("box/deref/u64/stl", deref<stl_box>);
+STL_BENCHMARK("box/deref/u64/std", deref<std_box>);
+
+}  // namespace
@@ -0,0 +1,111 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace {
+
+constexpr double min_time_ns = 2e8;
+
+struct result {
+  std::string name;
+  double ns_per_iter;
+  std::size_t iterations;
+  std::vector<std::pair<std::string, double>> counters;
+};
+
+auto run(const stl::bench::benchmark& bench) -> result {
+  std::size_t iterations = 1;
+  while (true) {
+    stl::bench::state state(iterations);
+    bench.body(state);
+    double ns = stl::bench::elapsed_ns(state.start());
+    if (ns >= min_time_ns || iterations >= (std::size_t{1} << 30)) {
+      return {bench.name, ns / static_cast<double>(iterations), iterations,
+              state.counters()};
+    }
+    double scale = ns > 0 ? 1.2 * min_time_ns / ns : 10.0;
+    scale = scale > 10.0 ? 10.0 : scale;
+    iterations =
+        static_cast<std::size_t>(static_cast<double>(iterations) * scale) + 1;
+  }
+}
+
+auto print_text(const result& run) -> void {
+  std::printf("%-48s %14.1f ns/iter %12zu iters", run.name.c_str(),
+              run.ns_per_iter, run.iterations);
+  for (const auto& [name, value] : run.counters) {
+    std::printf("  %s=%.3f", name.c_str(), value);
+  }
+  std::printf("\n");
+}
+
+auto print_json_string(std::string_view text) -> void {
+  std::putchar('"');
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      std::putchar('\\');
+    }
+    std::putchar(c);
+  }
+  std::putchar('"');
+}
+
+// One object per line inside a single array, so the output is both valid
+// JSON and easy to diff between releases.
+auto print_json(const result& run, bool first) -> void {
+  std::printf(first ? "\n  {\"name\": " : ",\n  {\"name\": ");
+  print_json_string(run.name);
+  std::printf(", \"ns_per_iter\": %.3f, \"iterations\": %zu", run.ns_per_iter,
+              run.iterations);
+  std::printf(", \"counters\": {");
+  for (std::size_t i = 0; i < run.counters.size(); ++i) {
+    std::printf(i == 0 ? "" : ", ");
+    print_json_string(run.counters[i].first);
+    std::printf(": %.6g", run.counters[i].second);
+  }
+  std::printf("}}");
+  std::fflush(stdout);
+}
+
+}  // namespace
+
+// Usage: stl_bench [--filter=substring] [--format=text|json]
+auto main(int argc, char** argv) -> int {
+  std::string_view filter;
+  bool json = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strncmp(argv[i], "--filter=", 9) == 0) {
+      filter = argv[i] + 9;
+    } else if (std::strcmp(argv[i], "--format=json") == 0) {
+      json = true;
+    } else if (std::strcmp(argv[i], "--format=text") == 0) {
+      json = false;
+    } else {
+      std::fprintf(stderr, "stl_bench: unknown argument %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (json) {
+    std::printf("[");
+  }
+  bool first = true;
+  for (const auto& bench : stl::bench::registry()) {
+    if (filter.empty() || bench.name.find(filter) != std::string::npos) {
+      if (json) {
+        print_json(run(bench), first);
+      } else {
+        print_text(run(bench));
+      }
+      first = false;
+    }
+  }
+  if (json) {
+    std::printf(first ? "]\n" : "\n]\n");
+  }
+  return 0;
+}
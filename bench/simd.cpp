@@ -0,0 +1,120 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <stl/simd.hpp>
+
+#include "bench.hpp"
+
+namespace {
+
+using element = std::uint32_t;
+
+// 16 elements up to 1 GiB per buffer, growing 16x per step.
+constexpr std::size_t sizes[] = {
+    16, 256, 4096, 65536, 1 << 20, 1 << 24, std::size_t{1} << 28,
+};
+
+auto make_buffer(std::size_t n) -> std::vector<element> {
+  std::vector<element> values(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    values[i] = static_cast<element>(i % 1000);
+  }
+  return values;
+}
+
+template <bool Simd>
+auto equal(std::size_t n) {
+  return [n](stl::bench::state& state) {
+    auto lhs = make_buffer(n);
+    auto rhs = lhs;
+    state.reset_timer();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+      bool result = Simd ? stl::simd::equal(lhs.data(), rhs.data(), n)
+                         : stl::simd::detail::mismatch_scalar(
+                               lhs.data(), rhs.data(), n) == n;
+      stl::bench::do_not_optimize(result);
+    }
+  };
+}
+
+template <bool Simd>
+auto find(std::size_t n) {
+  return [n](stl::bench::state& state) {
+    auto values = make_buffer(n);
+    state.reset_timer();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+      auto pos = Simd ? stl::simd::find(values.data(), n, element{5000})
+                      : stl::simd::detail::find_scalar(values.data(), n,
+                                                       element{5000});
+      stl::bench::do_not_optimize(pos);
+    }
+  };
+}
+
+template <bool Simd>
+auto count(std::size_t n) {
+  return [n](stl::bench::state& state) {
+    auto values = make_buffer(n);
+    state.reset_timer();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+      auto hits = Simd ? stl::simd::count(values.data(), n, element{7})
+                       : stl::simd::detail::count_scalar(values.data(), n,
+                                                         element{7});
+      stl::bench::do_not_optimize(hits);
+    }
+  };
+}
+
+template <bool Simd>
+auto fill(std::size_t n) {
+  return [n](stl::bench::state& state) {
+    auto values = make_buffer(n);
+    state.reset_timer();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+      if (Simd) {
+        stl::simd::fill(values.data(), n, static_cast<element>(i));
+      } else {
+        stl::simd::detail::fill_scalar(values.data(), n,
+                                       static_cast<element>(i));
+      }
+      stl::bench::clobber_memory();
+    }
+  };
+}
+
+template <bool Simd>
+auto min(std::size_t n) {
+  return [n](stl::bench::state& state) {
+    auto values = make_buffer(n);
+    state.reset_timer();
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+      auto result = Simd ? stl::simd::min(values.data(), n)
+                         : stl::simd::detail::min_scalar(values.data(), n);
+      stl::bench::do_not_optimize(result);
+    }
+  };
+}
+
+template <typename Make>
+auto add(const char* name, Make make) -> void {
+  for (std::size_t n : sizes) {
+    auto prefix = std::string("simd/") + name;
+    auto suffix = "/" + std::to_string(n);
+    stl::bench::registration(prefix + "/scalar" + suffix,
+                             make.template operator()<false>(n));
+    stl::bench::registration(prefix + "/dispatch" + suffix,
+                             make.template operator()<true>(n));
+  }
+}
+
+const bool registered = [] {
+  add("equal", []<bool Simd>(std::size_t n) { return equal<Simd>(n); });
+  add("find", []<bool Simd>(std::size_t n) { return find<Simd>(n); });
+  add("count", []<bool Simd>(std::size_t n) { return count<Simd>(n); });
+  add("fill", []<bool Simd>(std::size_t n) { return fill<Simd>(n); });
+  add("min", []<bool Simd>(std::size_t n) { return min<Simd>(n); });
+  return true;
+}();
+
+}  // namespace
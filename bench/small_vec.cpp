@@ -0,0 +1,48 @@
+#include <cstdint>
+#include <string>
+
+#include <stl/small_vec.hpp>
+#include <stl/vec.hpp>
+
+#include "bench.hpp"
+
+namespace {
+
+using element = std::uint64_t;
+
+// Builds a container of n elements, reads it back and destroys it, as a
+// per-message vector would. Every vec iteration pays for an allocation;
+// small_vec only does once n exceeds its inline capacity.
+template <typename Container>
+auto build(std::size_t n) {
+  return [n](stl::bench::state& state) {
+    for (std::size_t i = 0; i < state.iterations(); ++i) {
+      Container values;
+      for (std::size_t j = 0; j < n; ++j) {
+        values.push_back(static_cast<element>(i + j));
+      }
+      element sum = 0;
+      for (element value : values) {
+        sum += value;
+      }
+      stl::bench::do_not_optimize(sum);
+    }
+  };
+}
+
+const bool registered = [] {
+  for (std::size_t n = 1; n <= 16; n *= 2) {
+    auto suffix = "/" + std::to_string(n);
+    stl::bench::registration("small_vec/vec" + suffix,
+                             build<stl::vec<element>>(n));
+    stl::bench::registration("small_vec/inline4" + suffix,
+                             build<stl::small_vec<element, 4>>(n));
+    stl::bench::registration("small_vec/inline8" + suffix,
+                             build<stl::small_vec<element, 8>>(n));
+    stl::bench::registration("small_vec/inline16" + suffix,
+                             build<stl::small_vec<element, 16>>(n));
+  }
+  return true;
+}();
+
+}  // namespace
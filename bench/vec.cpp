@@ -0,0 +1,87 @@
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <stl/vec.hpp>
+
+#include "bench.hpp"
+
+namespace {
+
+using element = std::uint64_t;
+
+constexpr std::size_t small = 1024;
+constexpr std::size_t large = std::size_t{1} << 16;
+
+template <typename Vector>
+auto push_back(stl::bench::state& state) -> void {
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    Vector values;
+    for (std::size_t j = 0; j < small; ++j) {
+      values.push_back(typename Vector::value_type{});
+    }
+    stl::bench::do_not_optimize(values.data());
+  }
+}
+
+template <typename Vector>
+auto push_back_reserved(stl::bench::state& state) -> void {
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    Vector values;
+    values.reserve(small);
+    for (std::size_t j = 0; j < small; ++j) {
+      values.push_back(typename Vector::value_type{});
+    }
+    stl::bench::do_not_optimize(values.data());
+  }
+}
+
+template <typename Vector>
+auto filled(std::size_t n) -> Vector {
+  Vector values;
+  values.reserve(n);
+  for (std::size_t j = 0; j < n; ++j) {
+    values.push_back(static_cast<typename Vector::value_type>(j));
+  }
+  return values;
+}
+
+template <typename Vector>
+auto copy(stl::bench::state& state) -> void {
+  Vector source = filled<Vector>(large);
+  state.reset_timer();
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    Vector values(source);
+    stl::bench::do_not_optimize(values.data());
+  }
+}
+
+// Equal contents, so the comparison has to read both vectors to the end.
+template <typename Vector>
+auto compare(stl::bench::state& state) -> void {
+  Vector lhs = filled<Vector>(large);
+  Vector rhs = filled<Vector>(large);
+  state.reset_timer();
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    stl::bench::clobber_memory();
+    bool equal = lhs == rhs;
+    stl::bench::do_not_optimize(equal);
+  }
+}
+
+STL_BENCHMARK("vec/push_back/u64/stl", push_back<stl::vec<element>>);
+STL_BENCHMARK("vec/push_back/u64/std", push_back<std::vector<element>>);
+STL_BENCHMARK("vec/push_back/string/stl", push_back<stl::vec<std::string>>);
+STL_BENCHMARK("vec/push_back/string/std",
+              push_back<std::vector<std::string>>);
+STL_BENCHMARK("vec/push_back_reserved/u64/stl",
+              push_back_reserved<stl::vec<element>>);
+STL_BENCHMARK("vec/push_back_reserved/u64/std",
+              push_back_reserved<std::vector<element>>);
+STL_BENCHMARK("vec/copy/u64/stl", copy<stl::vec<element>>);
+STL_BENCHMARK("vec/copy/u64/std", copy<std::vector<element>>);
+STL_BENCHMARK("vec/compare/u64/stl", compare<stl::vec<element>>);
+STL_BENCHMARK("vec/compare/u64/std", compare<std::vector<element>>);
+
+}  // namespace
@@ -0,0 +1,40 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+#include <stl/vec.hpp>
+
+#include "bench.hpp"
+
+namespace {
+
+// 2^25 uint64_t elements: the last doubling moves a 256 MiB buffer.
+constexpr std::size_t element_count = std::size_t{1} << 25;
+
+// Appends element_count values and records the slowest push_back, which is
+// the one that triggered the final reallocation.
+template <typename Allocator>
+auto grow(stl::bench::state& state) -> void {
+  double worst_ns = 0;
+  for (std::size_t i = 0; i < state.iterations(); ++i) {
+    stl::vec<std::uint64_t, Allocator> values;
+    for (std::uint64_t j = 0; j < element_count; ++j) {
+      if (values.size() == values.capacity()) {
+        auto start = stl::bench::clock::now();
+        values.push_back(j);
+        worst_ns = std::max(worst_ns, stl::bench::elapsed_ns(start));
+      } else {
+        values.push_back(j);
+      }
+    }
+    stl::bench::do_not_optimize(values.data());
+  }
+  state.counter("max_stall_ms", worst_ns / 1e6);
+}
+
+STL_BENCHMARK("vec_growth/std_allocator/u64",
+              grow<std::allocator<std::uint64_t>>);
+STL_BENCHMARK("vec_growth/stl_allocator/u64",
+              grow<stl::allocator<std::uint64_t>>);
+
+}  // namespace
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace stl {
+
+inline constexpr std::size_t cache_line_size = 64;
+
+inline constexpr std::size_t huge_page_size = std::size_t{2} << 20;
+
+enum class page_mode {
+  // Regular pages.
+  standard,
+  // Large blocks are 2 MiB aligned and flagged with madvise(MADV_HUGEPAGE)
+  // so that transparent huge pages can back them.
+  transparent_huge,
+  // Large blocks are mapped with MAP_HUGETLB from the reserved huge page
+  // pool, falling back to transparent_huge when the pool is exhausted.
+  huge_tlb,
+};
+
+// Stateless allocator backed by malloc for small blocks and, on Linux, by
+// anonymous mappings for large ones. On top of the standard allocator
+// interface it provides reallocate(), which vec uses to grow trivially
+// relocatable elements without an allocate/copy/free round trip: realloc can
+// often extend a heap block in place, and mremap moves a mapped block by
+// remapping its pages rather than copying them.
+//
+// Align raises the alignment of every block (e.g. cache_line_size for SIMD
+// loops without peeling); Pages opts large blocks into huge pages.
+template <typename T,
+          std::size_t Align = alignof(T),
+          page_mode Pages = page_mode::standard>
+class allocator {
+  static_assert((Align & (Align - 1)) == 0,
+                "allocator: alignment must be a power of two");
+
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using propagate_on_container_move_assignment = std::true_type;
+  using is_always_equal = std::true_type;
+
+  template <typename U>
+  struct rebind {
+    using other = allocator<U, Align, Pages>;
+  };
+
+  static constexpr std::size_t alignment = std::max(Align, alignof(T));
+
+  static_assert(alignment <= 4096,
+                "allocator: alignment cannot exceed the page size");
+
+  // Blocks of at least this many bytes are served by mmap on Linux.
+  static constexpr std::size_t mmap_threshold =
+      Pages == page_mode::standard ? std::size_t{32} << 20 : huge_page_size;
+
+  constexpr allocator() noexcept = default;
+
+  template <typename U>
+  constexpr allocator(const allocator<U, Align, Pages>&) noexcept {}
+
+  [[nodiscard]] auto allocate(size_type n) -> T* {
+    return static_cast<T*>(allocate_bytes(bytes_for(n)));
+  }
+
+  auto deallocate(T* ptr, size_type n) noexcept -> void {
+    deallocate_bytes(ptr, n * sizeof(T));
+  }
+
+  // Resizes the block at ptr from old_n to new_n elements, preserving the
+  // bytes of the first min(old_n, new_n) elements. Returns the possibly moved
+  // block. On failure throws std::bad_alloc and leaves the old block intact.
+  [[nodiscard]] auto reallocate(T* ptr, size_type old_n, size_type new_n)
+      -> T* {
+    std::size_t old_bytes = old_n * sizeof(T);
+    std::size_t new_bytes = bytes_for(new_n);
+
+#if defined(__linux__)
+    if (is_mapped(old_bytes) && is_mapped(new_bytes)) {
+      void* moved = ::mremap(ptr, map_length(old_bytes), map_length(new_bytes),
+                             MREMAP_MAYMOVE);
+      if (moved != MAP_FAILED) {
+        advise(moved, map_length(new_bytes));
+        return static_cast<T*>(moved);
+      }
+      if constexpr (Pages != page_mode::huge_tlb) {
+        throw std::bad_alloc();
+      }
+      // hugetlbfs mappings may refuse to be remapped; copy instead.
+    }
+#endif
+
+    if (!is_mapped(old_bytes) && !is_mapped(new_bytes) && !over_aligned) {
+      void* moved = std::realloc(static_cast<void*>(ptr), new_bytes);
+      if (!moved) {
+        throw std::bad_alloc();
+      }
+      return static_cast<T*>(moved);
+    }
+
+    // Crossing between the heap and the mapping, or an over-aligned type that
+    // realloc cannot serve: fall back to a copy.
+    void* moved = allocate_bytes(new_bytes);
+    std::memcpy(moved, static_cast<const void*>(ptr),
+                old_bytes < new_bytes ? old_bytes : new_bytes);
+    deallocate_bytes(ptr, old_bytes);
+    return static_cast<T*>(moved);
+  }
+
+  template <typename U>
+  friend constexpr auto operator==(const allocator&,
+                                   const allocator<U, Align, Pages>&) noexcept
+      -> bool {
+    return true;
+  }
+
+ private:
+  static constexpr bool over_aligned = alignment > alignof(std::max_align_t);
+
+  static constexpr std::size_t map_granularity =
+      Pages == page_mode::standard ? 4096 : huge_page_size;
+
+  static auto bytes_for(size_type n) -> std::size_t {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return n * sizeof(T);
+  }
+
+  static auto is_mapped([[maybe_unused]] std::size_t bytes) noexcept -> bool {
+#if defined(__linux__)
+    return bytes >= mmap_threshold;
+#else
+    return false;
+#endif
+  }
+
+  static auto map_length(std::size_t bytes) noexcept -> std::size_t {
+    return (bytes + map_granularity - 1) & ~(map_granularity - 1);
+  }
+
+#if defined(__linux__)
+  static auto advise([[maybe_unused]] void* ptr,
+                     [[maybe_unused]] std::size_t length) noexcept -> void {
+    if constexpr (Pages != page_mode::standard) {
+      ::madvise(ptr, length, MADV_HUGEPAGE);
+    }
+  }
+
+  // Maps length bytes, aligned to a huge page boundary unless Pages is
+  // standard. Returns nullptr on failure.
+  static auto map(std::size_t length) noexcept -> void* {
+    constexpr int protection = PROT_READ | PROT_WRITE;
+    constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    if constexpr (Pages == page_mode::huge_tlb) {
+      void* ptr =
+          ::mmap(nullptr, length, protection, flags | MAP_HUGETLB, -1, 0);
+      if (ptr != MAP_FAILED) {
+        return ptr;
+      }
+    }
+    if constexpr (Pages == page_mode::standard) {
+      void* ptr = ::mmap(nullptr, length, protection, flags, -1, 0);
+      return ptr == MAP_FAILED ? nullptr : ptr;
+    } else {
+      // Over-map by one huge page and trim both ends to an aligned window.
+      void* raw =
+          ::mmap(nullptr, length + huge_page_size, protection, flags, -1, 0);
+      if (raw == MAP_FAILED) {
+        return nullptr;
+      }
+      auto base = reinterpret_cast<std::uintptr_t>(raw);
+      auto aligned = (base + huge_page_size - 1) & ~(huge_page_size - 1);
+      if (aligned != base) {
+        ::munmap(raw, aligned - base);
+      }
+      if (std::size_t tail = base + huge_page_size - aligned; tail != 0) {
+        ::munmap(reinterpret_cast<void*>(aligned + length), tail);
+      }
+      auto* ptr = reinterpret_cast<void*>(aligned);
+      advise(ptr, length);
+      return ptr;
+    }
+  }
+#endif
+
+  static auto allocate_bytes(std::size_t bytes) -> void* {
+    void* ptr = nullptr;
+#if defined(__linux__)
+    if (is_mapped(bytes)) {
+      ptr = map(map_length(bytes));
+      if (!ptr) {
+        throw std::bad_alloc();
+      }
+      return ptr;
+    }
+#endif
+    if constexpr (over_aligned) {
+      ptr = std::aligned_alloc(alignment,
+                               (bytes + alignment - 1) & ~(alignment - 1));
+    } else {
+      ptr = std::malloc(bytes);
+    }
+    if (!ptr) {
+      throw std::bad_alloc();
+    }
+    return ptr;
+  }
+
+  static auto deallocate_bytes(void* ptr,
+                               [[maybe_unused]] std::size_t bytes) noexcept
+      -> void {
+#if defined(__linux__)
+    if (is_mapped(bytes)) {
+      ::munmap(ptr, map_length(bytes));
+      return;
+    }
+#endif
+    std::free(ptr);
+  }
+};
+
+// Allocator whose blocks start on an Align-byte boundary.
+template <typename T, std::size_t Align = cache_line_size>
+using aligned_allocator = allocator<T, Align>;
+
+// Allocator that backs blocks of 2 MiB and more with huge pages.
+template <typename T, page_mode Pages = page_mode::transparent_huge>
+using huge_page_allocator = allocator<T, cache_line_size, Pages>;
+
+}  // namespace stl
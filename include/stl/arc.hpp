@@ -1,45 +1,602 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <compare>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
 #include <type_traits>
 #include <utility>
 
+#include "box.hpp"
+#include "instrument.hpp"
+#include "relocate.hpp"
+#include "slab_allocator.hpp"
+
 namespace stl {
 
+template <typename T, typename Counter>
+class basic_arc;
+
+template <typename T, typename Counter>
+class basic_weak_arc;
+
 template <typename T>
-class weak_arc;
+class atomic_arc;
+
+// Reference counts. atomic_count lets the handles of one object live on
+// different threads; plain_count is a bare integer for objects that never
+// leave their thread, and spares every copy and drop a locked instruction.
+class atomic_count {
+ public:
+  // Returns the new count.
+  auto add(std::size_t count) noexcept -> std::size_t {
+    return _value.fetch_add(count, std::memory_order_relaxed) + count;
+  }
+
+  // Increments the count unless it already reached zero.
+  auto try_add() noexcept -> bool {
+    std::size_t count = _value.load(std::memory_order_relaxed);
+    do {
+      if (count == 0) {
+        return false;
+      }
+    } while (!_value.compare_exchange_weak(count, count + 1,
+                                           std::memory_order_relaxed));
+    return true;
+  }
+
+  // Decrements the count and returns whether it reached zero.
+  auto drop() noexcept -> bool {
+    return _value.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+
+  auto load() const noexcept -> std::size_t {
+    return _value.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<std::size_t> _value{1};
+};
+
+class plain_count {
+ public:
+  auto add(std::size_t count) noexcept -> std::size_t {
+    return _value += count;
+  }
+
+  auto try_add() noexcept -> bool {
+    if (_value == 0) {
+      return false;
+    }
+    ++_value;
+    return true;
+  }
+
+  auto drop() noexcept -> bool {
+    return --_value == 0;
+  }
+
+  auto load() const noexcept -> std::size_t {
+    return _value;
+  }
+
+ private:
+  std::size_t _value{1};
+};
+
+template <typename T>
+using arc = basic_arc<T, atomic_count>;
 
 template <typename T>
-class arc {
+using weak_arc = basic_weak_arc<T, atomic_count>;
+
+namespace detail {
+
+template <typename T>
+auto voidify(T* ptr) noexcept -> void* {
+  return const_cast<void*>(static_cast<const volatile void*>(ptr));
+}
+
+// The counts shared by the arcs and weak_arcs of one object, at the start of
+// every kind of block. The arcs together hold one weak reference, so the
+// block outlives the object until the last weak_arc is gone. Each block type
+// has dispose() and destroy(), which destroy the object and free the block,
+// and which release_ref and release_weak_ref call on the exact type when the
+// arc knows it. Aliasing arcs do not know the type of their owner's block;
+// for them, the counts also keep a function that does the same through a
+// plain pointer.
+//
+// Blocks are aligned to 16 bytes so that atomic_arc can drop the low bits of
+// their addresses and keep a generation tag in the same word.
+template <typename Counter>
+class alignas(16) arc_block {
+ public:
+  enum class operation { dispose, destroy };
+
+  using manager = void (*)(arc_block*, operation) noexcept;
+
+  explicit arc_block(manager manage) noexcept : _manage(manage) {}
+
+  arc_block(const arc_block&) = delete;
+
+  auto operator=(const arc_block&) -> arc_block& = delete;
+
+  // Returns the new strong count.
+  auto add_ref(std::size_t count = 1) noexcept -> std::size_t {
+    return _ref_count.add(count);
+  }
+
+  // Takes a strong reference unless the count already reached zero, in
+  // which case the object may be gone.
+  auto try_add_ref() noexcept -> bool {
+    return _ref_count.try_add();
+  }
+
+  // Drops a strong reference and returns whether it was the last one.
+  auto drop_ref() noexcept -> bool {
+    return _ref_count.drop();
+  }
+
+  auto add_weak_ref() noexcept -> void {
+    _weak_count.add(1);
+  }
+
+  // Drops a weak reference and returns whether it was the last one.
+  auto drop_weak_ref() noexcept -> bool {
+    return _weak_count.drop();
+  }
+
+  auto ref_count() const noexcept -> std::size_t {
+    return _ref_count.load();
+  }
+
+  auto dispose() noexcept -> void {
+    _manage(this, operation::dispose);
+  }
+
+  auto destroy() noexcept -> void {
+    _manage(this, operation::destroy);
+  }
+
+ private:
+  Counter _ref_count;
+  Counter _weak_count;
+  manager _manage;
+};
+
+// The paths that free the object and the block are kept out of line. They
+// are rare, which keeps inlined copies and drops small, and the compiler
+// never sees a delete followed by another handle's update of the same
+// counts, which it would flag as a use after free when the counts are plain
+// integers.
+template <typename Block>
+[[gnu::noinline]] auto destroy_block(Block* block) noexcept -> void {
+  block->destroy();
+}
+
+template <typename Block>
+auto release_weak_ref(Block* block) noexcept -> void {
+  if (block->drop_weak_ref()) {
+    destroy_block(block);
+  }
+}
+
+template <typename Block>
+[[gnu::noinline]] auto release_last_ref(Block* block) noexcept -> void {
+  block->dispose();
+  release_weak_ref(block);
+}
+
+template <typename Block>
+auto release_ref(Block* block) noexcept -> void {
+  if (block->drop_ref()) {
+    release_last_ref(block);
+  }
+}
+
+// A T stored right after the counts, as make_arc allocates it. The object
+// lives in raw storage so that it can be destroyed as soon as the last arc
+// goes away, while weak_arcs keep only the counts alive.
+template <typename T, typename Counter>
+class arc_inline_block final : public arc_block<Counter> {
+  using base = arc_block<Counter>;
+  using typename base::operation;
+
+ public:
+  template <typename... Args>
+  explicit arc_inline_block(Args&&... args) : base(&manage) {
+    ::new (static_cast<void*>(_storage)) T(std::forward<Args>(args)...);
+    instrument::on_arc_create<basic_arc<T, Counter>>();
+    instrument::on_ref<basic_arc<T, Counter>>(1);
+  }
+
+  auto get() noexcept -> T* {
+    return std::launder(reinterpret_cast<T*>(_storage));
+  }
+
+  auto dispose() noexcept -> void {
+    std::destroy_at(get());
+  }
+
+  auto destroy() noexcept -> void {
+    instrument::on_arc_destroy<basic_arc<T, Counter>>();
+    delete this;
+  }
+
+ private:
+  static auto manage(base* counts, operation op) noexcept -> void {
+    auto* block = static_cast<arc_inline_block*>(counts);
+    if (op == operation::dispose) {
+      block->dispose();
+    } else {
+      block->destroy();
+    }
+  }
+
+  alignas(T) std::byte _storage[sizeof(T)];
+};
+
+// A block whose object is not at a fixed offset and which is not freed with
+// delete, as allocate_arc makes them. It keeps a pointer to the object and
+// is always released through its counts' function.
+template <typename Counter>
+class arc_managed_block : public arc_block<Counter> {
+ public:
+  auto object() const noexcept -> void* {
+    return _object;
+  }
+
+ protected:
+  using typename arc_block<Counter>::manager;
+
+  explicit arc_managed_block(manager manage) noexcept
+      : arc_block<Counter>(manage) {}
+
+  ~arc_managed_block() = default;
+
+  void* _object{nullptr};
+};
+
+// Like arc_inline_block, but allocated, built and freed through a copy of
+// Allocator kept in the block.
+template <typename T, typename Allocator, typename Counter>
+class arc_allocated_block final : public arc_managed_block<Counter> {
+  using base = arc_managed_block<Counter>;
+  using counts_type = arc_block<Counter>;
+  using operation = typename counts_type::operation;
+  using block_allocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<arc_allocated_block>;
+  using block_traits = std::allocator_traits<block_allocator>;
+  using value_allocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<std::remove_cv_t<T>>;
+  using value_traits = std::allocator_traits<value_allocator>;
+
+ public:
+  template <typename... Args>
+  static auto create(const Allocator& alloc, Args&&... args)
+      -> arc_allocated_block* {
+    block_allocator allocator(alloc);
+    arc_allocated_block* block = block_traits::allocate(allocator, 1);
+    ::new (voidify(block)) arc_allocated_block(allocator);
+    try {
+      value_allocator values(allocator);
+      value_traits::construct(values, block->get(),
+                              std::forward<Args>(args)...);
+    } catch (...) {
+      block->~arc_allocated_block();
+      block_traits::deallocate(allocator, block, 1);
+      throw;
+    }
+    instrument::on_arc_create<basic_arc<T, Counter>>();
+    instrument::on_ref<basic_arc<T, Counter>>(1);
+    return block;
+  }
+
+ private:
+  explicit arc_allocated_block(const block_allocator& allocator) noexcept
+      : base(&manage), _allocator(allocator) {
+    this->_object = _storage;
+  }
+
+  auto get() noexcept -> T* {
+    return std::launder(reinterpret_cast<T*>(_storage));
+  }
+
+  static auto manage(counts_type* counts, operation op) noexcept -> void {
+    auto* block = static_cast<arc_allocated_block*>(counts);
+    if (op == operation::dispose) {
+      value_allocator values(block->_allocator);
+      value_traits::destroy(values, block->get());
+    } else {
+      instrument::on_arc_destroy<basic_arc<T, Counter>>();
+      block_allocator allocator(std::move(block->_allocator));
+      block->~arc_allocated_block();
+      block_traits::deallocate(allocator, block, 1);
+    }
+  }
+
+  [[no_unique_address]] block_allocator _allocator;
+  alignas(T) std::byte _storage[sizeof(T)];
+};
+
+// Blocks are 16-byte aligned, which leaves bit 0 of their address free for
+// arc_pointer's tag.
+inline constexpr std::uintptr_t arc_managed_tag = 1;
+
+// Block addresses fit in 48 bits, which holds for user space on x86-64 and
+// AArch64 unless 57-bit addressing has been explicitly requested from the
+// kernel. Aliasing arcs keep the offset of their object from their owner's
+// counts in the 16 bits above.
+inline constexpr int arc_offset_shift = 48;
+inline constexpr std::uintptr_t arc_max_offset = 0xffff;
+inline constexpr std::uintptr_t arc_address_mask =
+    static_cast<std::uintptr_t>((std::uint64_t{1} << arc_offset_shift) - 1) &
+    ~std::uintptr_t{15};
+
+// The counts of the block an arc's bits point to.
+template <typename Counter>
+auto arc_counts(std::uintptr_t bits) noexcept -> arc_block<Counter>* {
+  return reinterpret_cast<arc_block<Counter>*>(bits & arc_address_mask);
+}
+
+// The offset of an aliasing arc's object from its counts, or 0 for arcs
+// that point at their block's own object.
+inline auto arc_offset(std::uintptr_t bits) noexcept -> std::uintptr_t {
+  return static_cast<std::uintptr_t>(std::uint64_t{bits} >> arc_offset_shift);
+}
+
+// The one word an arc<T> or weak_arc<T> holds: the address of its block's
+// counts, tagged with arc_managed_tag when the block is an arc_managed_block
+// and untagged when it is the arc_inline_block<T> of make_arc. Arcs from
+// make_arc thus reach their object at a fixed offset and free it without an
+// indirect call. An aliasing arc holds the word of its owner, whose block
+// may be of any kind, with the offset of its own object added on top; it
+// is released through its counts' function.
+template <typename T, typename Counter>
+class arc_pointer {
+  using counts_type = arc_block<Counter>;
+  using inline_type = arc_inline_block<T, Counter>;
+  using managed_type = arc_managed_block<Counter>;
+
+ public:
+  arc_pointer() noexcept : _bits(0) {}
+
+  explicit arc_pointer(inline_type* block) noexcept
+      : _bits(reinterpret_cast<std::uintptr_t>(
+            static_cast<counts_type*>(block))) {}
+
+  explicit arc_pointer(managed_type* block) noexcept
+      : _bits(reinterpret_cast<std::uintptr_t>(
+                  static_cast<counts_type*>(block)) |
+              arc_managed_tag) {}
+
+  static auto from_bits(std::uintptr_t bits) noexcept -> arc_pointer {
+    arc_pointer ptr;
+    ptr._bits = bits;
+    return ptr;
+  }
+
+  // Shares the block of owner_bits, pointing offset bytes past its counts.
+  static auto alias(std::uintptr_t owner_bits, std::uintptr_t offset) noexcept
+      -> arc_pointer {
+    return from_bits((owner_bits & (arc_address_mask | arc_managed_tag)) |
+                     static_cast<std::uintptr_t>(std::uint64_t{offset}
+                                                 << arc_offset_shift));
+  }
+
+  auto bits() const noexcept -> std::uintptr_t {
+    return _bits;
+  }
+
+  explicit operator bool() const noexcept {
+    return _bits != 0;
+  }
+
+  auto counts() const noexcept -> counts_type* {
+    return arc_counts<Counter>(_bits);
+  }
+
+  auto get() const noexcept -> T* {
+    if (std::uintptr_t offset = arc_offset(_bits)) {
+      return reinterpret_cast<T*>(reinterpret_cast<std::byte*>(counts()) +
+                                  offset);
+    }
+    if (_bits & arc_managed_tag) {
+      return static_cast<T*>(managed()->object());
+    }
+    return _bits ? inline_block()->get() : nullptr;
+  }
+
+  auto release_ref() const noexcept -> void {
+    if (erased()) {
+      detail::release_ref(counts());
+    } else {
+      detail::release_ref(inline_block());
+    }
+  }
+
+  auto release_weak_ref() const noexcept -> void {
+    if (erased()) {
+      detail::release_weak_ref(counts());
+    } else {
+      detail::release_weak_ref(inline_block());
+    }
+  }
+
+ private:
+  auto inline_block() const noexcept -> inline_type* {
+    return static_cast<inline_type*>(counts());
+  }
+
+  auto managed() const noexcept -> managed_type* {
+    return static_cast<managed_type*>(counts());
+  }
+
+  // Whether the block's type is not known from T, so that it must be
+  // released through its counts' function.
+  auto erased() const noexcept -> bool {
+    return (_bits & arc_managed_tag) || arc_offset(_bits) != 0;
+  }
+
+  std::uintptr_t _bits;
+};
+
+// The counts and the length, followed in the same allocation by the
+// elements.
+template <typename T, typename Counter>
+class arc_array_block final : public arc_block<Counter> {
+  using base = arc_block<Counter>;
+  using typename base::operation;
+
+ public:
+  // Allocates a block for n elements and builds them with init(data, n),
+  // which must destroy whatever it built if it throws.
+  template <typename Init>
+  static auto create(std::size_t n, Init init) -> arc_array_block* {
+    std::size_t size = bytes(n);
+    void* memory = ::operator new(size, alignment());
+    auto* block = ::new (memory) arc_array_block(n);
+    try {
+      init(block->data(), n);
+    } catch (...) {
+      ::operator delete(memory, size, alignment());
+      throw;
+    }
+    instrument::on_arc_create<basic_arc<T[], Counter>>();
+    instrument::on_ref<basic_arc<T[], Counter>>(1);
+    return block;
+  }
+
+  auto data() noexcept -> T* {
+    return reinterpret_cast<T*>(reinterpret_cast<std::byte*>(this) +
+                                data_offset());
+  }
+
+  auto size() const noexcept -> std::size_t {
+    return _size;
+  }
+
+  auto dispose() noexcept -> void {
+    std::destroy_n(data(), _size);
+  }
+
+  auto destroy() noexcept -> void {
+    instrument::on_arc_destroy<basic_arc<T[], Counter>>();
+    std::size_t size = data_offset() + _size * sizeof(T);
+    this->~arc_array_block();
+    ::operator delete(this, size, alignment());
+  }
+
+ private:
+  explicit arc_array_block(std::size_t n) noexcept : base(&manage), _size(n) {}
+
+  static auto manage(base* counts, operation op) noexcept -> void {
+    auto* block = static_cast<arc_array_block*>(counts);
+    if (op == operation::dispose) {
+      block->dispose();
+    } else {
+      block->destroy();
+    }
+  }
+
+  static constexpr auto alignment() noexcept -> std::align_val_t {
+    return std::align_val_t{std::max(alignof(arc_array_block), alignof(T))};
+  }
+
+  static constexpr auto data_offset() noexcept -> std::size_t {
+    return (sizeof(arc_array_block) + alignof(T) - 1) & ~(alignof(T) - 1);
+  }
+
+  static auto bytes(std::size_t n) -> std::size_t {
+    if (n > (std::numeric_limits<std::size_t>::max() - data_offset()) /
+                sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return data_offset() + n * sizeof(T);
+  }
+
+  std::size_t _size;
+};
+
+}  // namespace detail
+
+// A reference-counted pointer. It is one word: the tagged address of a block
+// that holds the counts and, for pointers from make_arc, the object itself.
+// Counter decides whether the counts are atomic; arc and rc name the two
+// choices.
+template <typename T, typename Counter>
+class basic_arc {
  public:
   using element_type = std::remove_extent_t<T>;
-  using weak_type = weak_arc<T>;
+  using weak_type = basic_weak_arc<T, Counter>;
 
-  arc() noexcept : _block(nullptr) {}
+  basic_arc() noexcept = default;
 
   template <typename... Args>
     requires std::is_constructible_v<T, Args...>
-  explicit arc(Args&&... args)
-      : _block(new control_block(std::forward<Args>(args)...)) {}
+  explicit basic_arc(Args&&... args)
+      : _ptr(new inline_block(std::forward<Args>(args)...)) {}
 
-  arc(const arc& other) noexcept : _block(other._block) {
-    if (_block) {
-      _block->add_ref();
+  // Unlike the constructor above, also builds T with no arguments.
+  template <typename... Args>
+    requires std::is_constructible_v<T, Args...>
+  explicit basic_arc(std::in_place_t, Args&&... args)
+      : _ptr(new inline_block(std::forward<Args>(args)...)) {}
+
+  // Allocates the object and its counts together through alloc, which the
+  // block keeps to free them with.
+  template <typename Allocator, typename... Args>
+    requires std::is_constructible_v<T, Args...>
+  basic_arc(std::allocator_arg_t, const Allocator& alloc, Args&&... args)
+      : _ptr(detail::arc_allocated_block<T, Allocator, Counter>::create(
+            alloc, std::forward<Args>(args)...)) {}
+
+  // Shares ownership with owner but points at ptr, a member or element of
+  // *owner. Allocates nothing: the arc holds owner's word with the offset of
+  // ptr from owner's counts on top, so copies, use_count() and weak_arcs all
+  // go through owner's counts, as with std::shared_ptr. ptr must therefore
+  // lie in owner's block, within 64 KiB of its start; throws
+  // std::out_of_range otherwise. An empty owner or a null ptr gives an empty
+  // arc.
+  template <typename U>
+  basic_arc(const basic_arc<U, Counter>& owner, element_type* ptr)
+      : _ptr(alias(owner.bits(), ptr)) {
+    if (_ptr) {
+      instrument::on_ref<basic_arc>(_ptr.counts()->add_ref());
     }
   }
 
-  arc(arc&& other) noexcept : _block(std::exchange(other._block, nullptr)) {}
+  // Takes over owner's reference, unless the result is empty.
+  template <typename U>
+  basic_arc(basic_arc<U, Counter>&& owner, element_type* ptr)
+      : _ptr(alias(owner.bits(), ptr)) {
+    if (_ptr) {
+      static_cast<void>(std::move(owner).into_bits());
+    }
+  }
 
-  ~arc() {
-    if (_block) {
-      _block->release_ref();
+  basic_arc(const basic_arc& other) noexcept : _ptr(other._ptr) {
+    if (_ptr) {
+      instrument::on_ref<basic_arc>(_ptr.counts()->add_ref());
+    }
+  }
+
+  basic_arc(basic_arc&& other) noexcept : _ptr(std::exchange(other._ptr, {})) {}
+
+  ~basic_arc() {
+    if (_ptr) {
+      _ptr.release_ref();
     }
   }
 
   auto use_count() const noexcept -> std::size_t {
-    return _block ? _block->ref_count() : 0;
+    return _ptr ? _ptr.counts()->ref_count() : 0;
   }
 
   auto unique() const noexcept -> bool {
@@ -47,122 +604,144 @@ class arc {
   }
 
   auto get() const noexcept -> element_type* {
-    return _block ? &_block->_object : nullptr;
+    return _ptr.get();
   }
 
   explicit operator bool() const noexcept {
-    return _block != nullptr;
+    return get() != nullptr;
   }
 
   auto operator*() const -> element_type& {
-    return _block->_object;
+    return *get();
   }
 
   auto operator->() const -> element_type* {
-    return &_block->_object;
+    return get();
   }
 
-  auto operator=(const arc& other) noexcept -> arc& {
+  auto operator=(const basic_arc& other) noexcept -> basic_arc& {
     if (this != &other) {
-      if (_block) {
-        _block->release_ref();
-      }
-      _block = other._block;
-      if (_block) {
-        _block->add_ref();
+      if (other._ptr) {
+        instrument::on_ref<basic_arc>(other._ptr.counts()->add_ref());
       }
+      reset(other._ptr);
     }
     return *this;
   }
 
-  auto operator=(arc&& other) noexcept -> arc& {
+  auto operator=(basic_arc&& other) noexcept -> basic_arc& {
     if (this != &other) {
-      if (_block) {
-        _block->release_ref();
-      }
-      _block = std::exchange(other._block, nullptr);
+      reset(std::exchange(other._ptr, {}));
     }
     return *this;
   }
 
-  auto operator==(const arc& other) const noexcept -> bool {
+  auto operator==(const basic_arc& other) const noexcept -> bool {
     return get() == other.get();
   }
 
-  auto operator<=>(const arc& other) const noexcept -> std::strong_ordering {
+  auto operator<=>(const basic_arc& other) const noexcept
+      -> std::strong_ordering {
     return get() <=> other.get();
   }
 
  private:
-  struct control_block {
-    template <typename... Args>
-    explicit control_block(Args&&... args)
-        : _object(std::forward<Args>(args)...) {}
+  using pointer_type = detail::arc_pointer<element_type, Counter>;
+  using inline_block = detail::arc_inline_block<T, Counter>;
 
-    ~control_block() = default;
+  pointer_type _ptr;
 
-    auto add_ref() noexcept -> void {
-      _ref_count.fetch_add(1, std::memory_order_relaxed);
-    }
+  // Friend declarations
+  template <typename, typename>
+  friend class basic_arc;
+  friend class basic_weak_arc<T, Counter>;
+  friend class atomic_arc<T>;
 
-    auto release_ref() noexcept -> void {
-      if (_ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
-        release_weak_ref();
-      }
-    }
+  // Adopts a strong reference the caller already took.
+  explicit basic_arc(pointer_type ptr) noexcept : _ptr(ptr) {}
 
-    auto add_weak_ref() noexcept -> void {
-      _weak_count.fetch_add(1, std::memory_order_relaxed);
-    }
+  static auto from_bits(std::uintptr_t bits) noexcept -> basic_arc {
+    return basic_arc(pointer_type::from_bits(bits));
+  }
 
-    auto release_weak_ref() noexcept -> void {
-      if (_weak_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
-        delete this;
-      }
+  // The word of an arc sharing owner_bits' block and pointing at ptr. Takes
+  // no reference.
+  static auto alias(std::uintptr_t owner_bits, element_type* ptr)
+      -> pointer_type {
+    static_assert(sizeof(void*) == 8, "arc: aliasing requires 64-bit pointers");
+    if (!owner_bits || !ptr) {
+      return {};
     }
-
-    auto ref_count() const noexcept -> std::size_t {
-      return _ref_count.load(std::memory_order_relaxed);
+    auto counts = reinterpret_cast<std::uintptr_t>(
+        detail::arc_counts<Counter>(owner_bits));
+    std::uintptr_t offset =
+        reinterpret_cast<std::uintptr_t>(detail::voidify(ptr)) - counts;
+    // The counts themselves sit at offset 0, so no object can.
+    if (offset == 0 || offset > detail::arc_max_offset) {
+      throw std::out_of_range(
+          "arc: aliased pointer is not within 64 KiB of its owner's block");
     }
+    return pointer_type::alias(owner_bits, offset);
+  }
 
-    std::atomic<std::size_t> _ref_count{1};
-    std::atomic<std::size_t> _weak_count{1};
-    T _object;
-  };
-
-  control_block* _block{nullptr};
+  auto bits() const noexcept -> std::uintptr_t {
+    return _ptr.bits();
+  }
 
-  // Friend declarations
-  friend class weak_arc<T>;
+  // Gives up this arc's reference as bits that from_bits turns back into an
+  // equal arc.
+  auto into_bits() && noexcept -> std::uintptr_t {
+    return std::exchange(_ptr, {}).bits();
+  }
 
-  explicit arc(control_block* block) noexcept : _block(block) {
-    if (_block) {
-      _block->add_ref();
+  // Takes over ptr's reference and drops the old one. The old reference
+  // goes last, since destroying the object may reach this arc.
+  auto reset(pointer_type ptr) noexcept -> void {
+    pointer_type old = std::exchange(_ptr, ptr);
+    if (old) {
+      old.release_ref();
     }
   }
 };
 
-template <typename T>
-class arc<T[]> {
+template <typename T, typename Counter>
+class basic_arc<T[], Counter> {
  public:
   using element_type = std::remove_extent_t<T>;
-  using weak_type = weak_arc<T[]>;
+  using weak_type = basic_weak_arc<T[], Counter>;
+
+  basic_arc() noexcept : _block(nullptr) {}
 
-  arc() noexcept : _block(nullptr) {}
+  // n value-initialized elements.
+  explicit basic_arc(std::size_t n)
+      : _block(block_type::create(n, [](element_type* data, std::size_t m) {
+          std::uninitialized_value_construct_n(data, m);
+        })) {}
 
-  explicit arc(std::size_t n) : _block(new control_block(n)) {}
+  basic_arc(std::size_t n, const element_type& value)
+      : _block(block_type::create(
+            n, [&value](element_type* data, std::size_t m) {
+              std::uninitialized_fill_n(data, m, value);
+            })) {}
 
-  arc(const arc& other) noexcept : _block(other._block) {
+  // n default-initialized elements: trivial types are left uninitialized.
+  basic_arc(std::size_t n, for_overwrite_t)
+      : _block(block_type::create(n, [](element_type* data, std::size_t m) {
+          std::uninitialized_default_construct_n(data, m);
+        })) {}
+
+  basic_arc(const basic_arc& other) noexcept : _block(other._block) {
     if (_block) {
-      _block->add_ref();
+      instrument::on_ref<basic_arc>(_block->add_ref());
     }
   }
 
-  arc(arc&& other) noexcept : _block(std::exchange(other._block, nullptr)) {}
+  basic_arc(basic_arc&& other) noexcept
+      : _block(std::exchange(other._block, nullptr)) {}
 
-  ~arc() {
+  ~basic_arc() {
     if (_block) {
-      _block->release_ref();
+      detail::release_ref(_block);
     }
   }
 
@@ -175,7 +754,39 @@ class arc<T[]> {
   }
 
   auto get() const noexcept -> element_type* {
-    return _block ? _block->_data : nullptr;
+    return _block ? _block->data() : nullptr;
+  }
+
+  auto size() const noexcept -> std::size_t {
+    return _block ? _block->size() : 0;
+  }
+
+  auto empty() const noexcept -> bool {
+    return size() == 0;
+  }
+
+  auto span() noexcept -> std::span<element_type> {
+    return {get(), size()};
+  }
+
+  auto span() const noexcept -> std::span<const element_type> {
+    return {get(), size()};
+  }
+
+  auto begin() noexcept -> element_type* {
+    return get();
+  }
+
+  auto begin() const noexcept -> const element_type* {
+    return get();
+  }
+
+  auto end() noexcept -> element_type* {
+    return get() + size();
+  }
+
+  auto end() const noexcept -> const element_type* {
+    return get() + size();
   }
 
   explicit operator bool() const noexcept {
@@ -183,196 +794,179 @@ class arc<T[]> {
   }
 
   auto operator[](std::size_t index) const -> const element_type& {
-    return _block->_data[index];
+    return _block->data()[index];
   }
 
   auto operator[](std::size_t index) -> element_type& {
-    return _block->_data[index];
+    return _block->data()[index];
   }
 
-  auto operator=(const arc& other) noexcept -> arc& {
+  auto operator=(const basic_arc& other) noexcept -> basic_arc& {
     if (this != &other) {
-      if (_block) {
-        _block->release_ref();
-      }
-      _block = other._block;
-      if (_block) {
-        _block->add_ref();
+      if (other._block) {
+        instrument::on_ref<basic_arc>(other._block->add_ref());
       }
+      reset(other._block);
     }
     return *this;
   }
 
-  auto operator=(arc&& other) noexcept -> arc& {
+  auto operator=(basic_arc&& other) noexcept -> basic_arc& {
     if (this != &other) {
-      if (_block) {
-        _block->release_ref();
-      }
-      _block = std::exchange(other._block, nullptr);
+      reset(std::exchange(other._block, nullptr));
     }
     return *this;
   }
 
-  auto operator==(const arc& other) const noexcept -> bool {
+  auto operator==(const basic_arc& other) const noexcept -> bool {
     return get() == other.get();
   }
 
-  auto operator<=>(const arc& other) const noexcept -> std::strong_ordering {
+  auto operator<=>(const basic_arc& other) const noexcept
+      -> std::strong_ordering {
     return get() <=> other.get();
   }
 
  private:
-  struct control_block {
-    explicit control_block(std::size_t n)
-        : _data(new element_type[n]), _size(n) {}
+  using block_type = detail::arc_array_block<element_type, Counter>;
 
-    ~control_block() {
-      if (_data) {
-        delete[] _data;
-      }
-    }
+  block_type* _block;
 
-    auto add_ref() noexcept -> void {
-      _ref_count.fetch_add(1, std::memory_order_relaxed);
-    }
+  template <typename, typename>
+  friend class basic_arc;
+  friend class basic_weak_arc<T[], Counter>;
+  friend class atomic_arc<T[]>;
 
-    auto release_ref() noexcept -> void {
-      if (_ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
-        if (_data) {
-          delete[] _data;
-          _data = nullptr;
-        }
-        release_weak_ref();
-      }
-    }
-
-    auto add_weak_ref() noexcept -> void {
-      _weak_count.fetch_add(1, std::memory_order_relaxed);
-    }
-
-    auto release_weak_ref() noexcept -> void {
-      if (_weak_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
-        delete this;
-      }
-    }
-
-    auto ref_count() const noexcept -> std::size_t {
-      return _ref_count.load(std::memory_order_relaxed);
-    }
+  // Adopts a strong reference the caller already took.
+  explicit basic_arc(block_type* block) noexcept : _block(block) {}
 
-    std::atomic<std::size_t> _ref_count{1};
-    std::atomic<std::size_t> _weak_count{1};
-    element_type* _data{nullptr};
-    std::size_t _size{0};
-  };
+  static auto from_bits(std::uintptr_t bits) noexcept -> basic_arc {
+    return basic_arc(
+        static_cast<block_type*>(detail::arc_counts<Counter>(bits)));
+  }
 
-  control_block* _block{nullptr};
+  auto bits() const noexcept -> std::uintptr_t {
+    return reinterpret_cast<std::uintptr_t>(
+        static_cast<detail::arc_block<Counter>*>(_block));
+  }
 
-  friend class weak_arc<T[]>;
+  auto into_bits() && noexcept -> std::uintptr_t {
+    std::uintptr_t result = bits();
+    _block = nullptr;
+    return result;
+  }
 
-  explicit arc(control_block* block) noexcept : _block(block) {
-    if (_block) {
-      _block->add_ref();
+  auto reset(block_type* block) noexcept -> void {
+    if (block_type* old = std::exchange(_block, block)) {
+      detail::release_ref(old);
     }
   }
 };
 
-template <typename T>
-class weak_arc {
+template <typename T, typename Counter>
+class basic_weak_arc {
  public:
   using element_type = std::remove_extent_t<T>;
 
-  weak_arc() noexcept : _block(nullptr) {}
+  basic_weak_arc() noexcept = default;
 
-  weak_arc(const arc<T>& shared) noexcept : _block(shared._block) {
-    if (_block) {
-      _block->add_weak_ref();
+  basic_weak_arc(const basic_arc<T, Counter>& shared) noexcept
+      : _ptr(shared._ptr) {
+    if (_ptr) {
+      _ptr.counts()->add_weak_ref();
     }
   }
 
-  weak_arc(const weak_arc& other) noexcept : _block(other._block) {
-    if (_block) {
-      _block->add_weak_ref();
+  basic_weak_arc(const basic_weak_arc& other) noexcept : _ptr(other._ptr) {
+    if (_ptr) {
+      _ptr.counts()->add_weak_ref();
     }
   }
 
-  weak_arc(weak_arc&& other) noexcept
-      : _block(std::exchange(other._block, nullptr)) {}
+  basic_weak_arc(basic_weak_arc&& other) noexcept
+      : _ptr(std::exchange(other._ptr, {})) {}
 
-  ~weak_arc() {
-    if (_block) {
-      _block->release_weak_ref();
+  ~basic_weak_arc() {
+    if (_ptr) {
+      _ptr.release_weak_ref();
     }
   }
 
   auto use_count() const noexcept -> std::size_t {
-    return _block ? _block->ref_count() : 0;
+    return _ptr ? _ptr.counts()->ref_count() : 0;
   }
 
   auto expired() const noexcept -> bool {
     return use_count() == 0;
   }
 
-  auto lock() const noexcept -> arc<T> {
-    if (_block && _block->ref_count() > 0) {
-      return arc<T>(_block);
+  auto lock() const noexcept -> basic_arc<T, Counter> {
+    if (_ptr && _ptr.counts()->try_add_ref()) {
+      instrument::on_lock<basic_arc<T, Counter>>(true);
+      instrument::on_ref<basic_arc<T, Counter>>(_ptr.counts()->ref_count());
+      return basic_arc<T, Counter>(_ptr);
     } else {
-      return arc<T>();
+      instrument::on_lock<basic_arc<T, Counter>>(false);
+      return basic_arc<T, Counter>();
     }
   }
 
-  auto operator=(const weak_arc& other) noexcept -> weak_arc& {
+  auto operator=(const basic_weak_arc& other) noexcept -> basic_weak_arc& {
     if (this != &other) {
-      if (_block) {
-        _block->release_weak_ref();
-      }
-      _block = other._block;
-      if (_block) {
-        _block->add_weak_ref();
+      if (other._ptr) {
+        other._ptr.counts()->add_weak_ref();
       }
+      reset(other._ptr);
     }
     return *this;
   }
 
-  auto operator=(weak_arc&& other) noexcept -> weak_arc& {
+  auto operator=(basic_weak_arc&& other) noexcept -> basic_weak_arc& {
     if (this != &other) {
-      if (_block) {
-        _block->release_weak_ref();
-      }
-      _block = std::exchange(other._block, nullptr);
+      reset(std::exchange(other._ptr, {}));
     }
     return *this;
   }
 
  private:
-  typename arc<T>::control_block* _block{nullptr};
+  using pointer_type = detail::arc_pointer<element_type, Counter>;
+
+  auto reset(pointer_type ptr) noexcept -> void {
+    pointer_type old = std::exchange(_ptr, ptr);
+    if (old) {
+      old.release_weak_ref();
+    }
+  }
+
+  pointer_type _ptr;
 };
 
-template <typename T>
-class weak_arc<T[]> {
+template <typename T, typename Counter>
+class basic_weak_arc<T[], Counter> {
  public:
   using element_type = std::remove_extent_t<T>;
 
-  weak_arc() noexcept : _block(nullptr) {}
+  basic_weak_arc() noexcept : _block(nullptr) {}
 
-  weak_arc(const arc<T[]>& shared) noexcept : _block(shared._block) {
+  basic_weak_arc(const basic_arc<T[], Counter>& shared) noexcept
+      : _block(shared._block) {
     if (_block) {
       _block->add_weak_ref();
     }
   }
 
-  weak_arc(const weak_arc& other) noexcept : _block(other._block) {
+  basic_weak_arc(const basic_weak_arc& other) noexcept : _block(other._block) {
     if (_block) {
       _block->add_weak_ref();
     }
   }
 
-  weak_arc(weak_arc&& other) noexcept
+  basic_weak_arc(basic_weak_arc&& other) noexcept
       : _block(std::exchange(other._block, nullptr)) {}
 
-  ~weak_arc() {
+  ~basic_weak_arc() {
     if (_block) {
-      _block->release_weak_ref();
+      detail::release_weak_ref(_block);
     }
   }
 
@@ -384,46 +978,76 @@ class weak_arc<T[]> {
     return use_count() == 0;
   }
 
-  auto lock() const noexcept -> arc<T[]> {
-    if (_block && _block->ref_count() > 0) {
-      return arc<T[]>(_block);
+  auto lock() const noexcept -> basic_arc<T[], Counter> {
+    if (_block && _block->try_add_ref()) {
+      instrument::on_lock<basic_arc<T[], Counter>>(true);
+      instrument::on_ref<basic_arc<T[], Counter>>(_block->ref_count());
+      return basic_arc<T[], Counter>(_block);
     } else {
-      return arc<T[]>();
+      instrument::on_lock<basic_arc<T[], Counter>>(false);
+      return basic_arc<T[], Counter>();
     }
   }
 
-  auto operator=(const weak_arc& other) noexcept -> weak_arc& {
+  auto operator=(const basic_weak_arc& other) noexcept -> basic_weak_arc& {
     if (this != &other) {
-      if (_block) {
-        _block->release_weak_ref();
-      }
-      _block = other._block;
-      if (_block) {
-        _block->add_weak_ref();
+      if (other._block) {
+        other._block->add_weak_ref();
       }
+      reset(other._block);
     }
     return *this;
   }
 
-  auto operator=(weak_arc&& other) noexcept -> weak_arc& {
+  auto operator=(basic_weak_arc&& other) noexcept -> basic_weak_arc& {
     if (this != &other) {
-      if (_block) {
-        _block->release_weak_ref();
-      }
-      _block = std::exchange(other._block, nullptr);
+      reset(std::exchange(other._block, nullptr));
     }
     return *this;
   }
 
  private:
-  typename arc<T[]>::control_block* _block{nullptr};
+  using block_type = typename basic_arc<T[], Counter>::block_type;
+
+  auto reset(block_type* block) noexcept -> void {
+    if (block_type* old = std::exchange(_block, block)) {
+      detail::release_weak_ref(old);
+    }
+  }
+
+  block_type* _block{nullptr};
+};
+
+template <typename T, typename Counter>
+struct is_trivially_relocatable<basic_arc<T, Counter>> : std::true_type {};
+
+template <typename T, typename Counter>
+struct is_trivially_relocatable<basic_weak_arc<T, Counter>> : std::true_type {
 };
 
 template <typename T, typename... Args>
 auto make_arc(Args&&... args) -> arc<T>
   requires(!std::is_unbounded_array_v<T>)
 {
-  return arc<T>(std::forward<Args>(args)...);
+  return arc<T>(std::in_place, std::forward<Args>(args)...);
+}
+
+// make_arc, with the object and its counts allocated through alloc.
+template <typename T, typename Allocator, typename... Args>
+auto allocate_arc(const Allocator& alloc, Args&&... args) -> arc<T>
+  requires(!std::is_array_v<T>)
+{
+  return arc<T>(std::allocator_arg, alloc, std::forward<Args>(args)...);
+}
+
+// make_arc, with the block drawn from a per-thread slab pool instead of
+// malloc. Suits objects created and dropped at high rates; blocks freed on
+// another thread join that thread's pool.
+template <typename T, typename... Args>
+auto make_pooled_arc(Args&&... args) -> arc<T>
+  requires(!std::is_array_v<T>)
+{
+  return allocate_arc<T>(slab_allocator<T>(), std::forward<Args>(args)...);
 }
 
 template <typename T>
@@ -433,4 +1057,18 @@ auto make_arc(std::size_t n) -> arc<T>
   return arc<T>(n);
 }
 
+template <typename T>
+auto make_arc(std::size_t n, const std::remove_extent_t<T>& value) -> arc<T>
+  requires std::is_unbounded_array_v<T>
+{
+  return arc<T>(n, value);
+}
+
+template <typename T>
+auto make_arc_for_overwrite(std::size_t n) -> arc<T>
+  requires std::is_unbounded_array_v<T>
+{
+  return arc<T>(n, for_overwrite);
+}
+
 }  // namespace stl
@@ -1,11 +1,15 @@
 #pragma once
 
 #include <algorithm>
+#include <compare>
 #include <cstddef>
 #include <format>
 #include <iterator>
 #include <memory>
 #include <stdexcept>
+#include <type_traits>
+
+#include "simd.hpp"
 
 namespace stl {
 
@@ -154,13 +158,71 @@ class arr {
   }
 
   constexpr auto fill(const T& value) -> void {
-    std::uninitialized_fill(_buffer, _buffer + N, value);
+    if constexpr (simd::vectorizable<T>) {
+      if (!std::is_constant_evaluated()) {
+        simd::fill(_buffer, N, value);
+        return;
+      }
+    }
+    std::fill(_buffer, _buffer + N, value);
+  }
+
+  constexpr auto find(const T& value) -> iterator {
+    if constexpr (simd::vectorizable<T>) {
+      if (!std::is_constant_evaluated()) {
+        return _buffer + simd::find(_buffer, N, value);
+      }
+    }
+    return std::find(begin(), end(), value);
+  }
+
+  constexpr auto find(const T& value) const -> const_iterator {
+    return const_cast<arr&>(*this).find(value);
+  }
+
+  constexpr auto count(const T& value) const -> size_type {
+    if constexpr (simd::vectorizable<T>) {
+      if (!std::is_constant_evaluated()) {
+        return simd::count(_buffer, N, value);
+      }
+    }
+    return std::count(begin(), end(), value);
+  }
+
+  constexpr auto contains(const T& value) const -> bool {
+    return find(value) != end();
   }
 
   constexpr auto swap(arr& other) noexcept -> void {
     std::swap_ranges(begin(), end(), other.begin());
   }
 
+  constexpr auto operator==(const arr& other) const -> bool {
+    if constexpr (simd::vectorizable<T>) {
+      if (!std::is_constant_evaluated()) {
+        return simd::equal(_buffer, other._buffer, N);
+      }
+    }
+    return std::equal(begin(), end(), other.begin());
+  }
+
+  constexpr auto operator<=>(const arr& other) const
+    requires std::three_way_comparable<T>
+  {
+    using ordering = std::compare_three_way_result_t<T>;
+    if constexpr (simd::vectorizable<T>) {
+      if (!std::is_constant_evaluated()) {
+        size_type pos = simd::mismatch(_buffer, other._buffer, N);
+        if (pos != N) {
+          return ordering(_buffer[pos] <=> other._buffer[pos]);
+        }
+        return ordering(std::strong_ordering::equal);
+      }
+    }
+    return ordering(std::lexicographical_compare_three_way(
+        begin(), end(), other.begin(), other.end()));
+  }
+
  private:
   T _buffer[N];
 };
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "arc.hpp"
+
+namespace stl {
+
+// An arc that can be loaded and replaced concurrently, e.g. a configuration
+// snapshot read by many threads and swapped by a writer.
+//
+// Uses split reference counts. The one word of an arc, its block pointer,
+// shares one 64-bit atomic word with a local count and a generation. A
+// reader bumps the local count in that word, which keeps the block alive
+// while it takes a real strong reference, then gives the local count back.
+// If a writer replaced the word in the meantime, the writer has already
+// moved the outstanding local counts into the block's strong count, and the
+// reader drops that extra reference instead. Every store bumps the
+// generation, so a reader can tell a replaced word from one that merely
+// holds the same block again after a writer flipped away and back. Every
+// operation is a handful of atomic instructions on the word, lock-free
+// wherever 64-bit atomics are (x86-64, AArch64).
+//
+// An aliasing arc's offset does not fit in the word. Storing one allocates a
+// small cell holding it, which is why the members that store may throw, and
+// loads copy the arc out of the cell.
+//
+// The local count holds up to 511 loads in flight; a load that finds it full
+// yields until one of them finishes, so the count never carries into the
+// generation. A reader mistakes a replaced word for its own only if it
+// stalls in load() while exactly a multiple of 512 stores complete.
+template <typename T>
+class atomic_arc {
+  static_assert(sizeof(void*) == 8, "atomic_arc: requires 64-bit pointers");
+  static_assert(alignof(detail::arc_block<atomic_count>) >= 16,
+                "atomic_arc: blocks must leave four address bits free");
+
+ public:
+  using value_type = arc<T>;
+
+  atomic_arc() noexcept : _word(0) {}
+
+  atomic_arc(arc<T> desired) : _word(pack(stow(std::move(desired)), 0, 0)) {}
+
+  atomic_arc(const atomic_arc&) = delete;
+
+  ~atomic_arc() {
+    // The temporary arc drops the stored reference.
+    unstow(bits_of(_word.load()));
+  }
+
+  auto operator=(const atomic_arc&) -> atomic_arc& = delete;
+
+  auto operator=(arc<T> desired) -> atomic_arc& {
+    store(std::move(desired));
+    return *this;
+  }
+
+  operator arc<T>() const noexcept {
+    return load();
+  }
+
+  auto is_lock_free() const noexcept -> bool {
+    return _word.is_lock_free();
+  }
+
+  static constexpr bool is_always_lock_free =
+      std::atomic<std::uint64_t>::is_always_lock_free;
+
+  auto load() const noexcept -> arc<T> {
+    std::uint64_t tag;
+    return load(tag);
+  }
+
+  auto store(arc<T> desired) -> void {
+    exchange(std::move(desired));
+  }
+
+  auto exchange(arc<T> desired) -> arc<T> {
+    std::uintptr_t replacement = stow(std::move(desired));
+    std::uint64_t word = _word.load(std::memory_order_relaxed);
+    while (!_word.compare_exchange_weak(word, successor(word, replacement),
+                                        std::memory_order_acq_rel)) {
+    }
+    return adopt(word);
+  }
+
+  // Replaces the value with desired if it holds the same arc as expected,
+  // as arcs returned by load do; otherwise loads the current value into
+  // expected.
+  auto compare_exchange_strong(arc<T>& expected, arc<T> desired) -> bool {
+    std::uintptr_t replacement = stow(std::move(desired));
+    std::uint64_t word = _word.load(std::memory_order_acquire);
+    while (true) {
+      // Never true for a cell, whose bits no arc has.
+      if (bits_of(word) == expected.bits()) {
+        if (_word.compare_exchange_weak(word, successor(word, replacement),
+                                        std::memory_order_acq_rel)) {
+          adopt(word);
+          return true;
+        }
+        continue;
+      }
+      std::uint64_t tag;
+      arc<T> current = load(tag);
+      if (current.bits() != expected.bits()) {
+        expected = std::move(current);
+        unstow(replacement);
+        return false;
+      }
+      // The value is held in a cell, or came back since word was read.
+      // Replace it as long as the word is still the one current came from.
+      word = _word.load(std::memory_order_acquire);
+      while (word >> _count_bits == tag) {
+        if (_word.compare_exchange_weak(word, successor(word, replacement),
+                                        std::memory_order_acq_rel)) {
+          adopt(word);
+          return true;
+        }
+      }
+    }
+  }
+
+  auto compare_exchange_weak(arc<T>& expected, arc<T> desired) -> bool {
+    return compare_exchange_strong(expected, std::move(desired));
+  }
+
+ private:
+  // Holds an aliasing arc in place of its word.
+  using cell = detail::arc_inline_block<arc<T>, atomic_count>;
+
+  // Marks the bits of a cell. Blocks are 16-byte aligned, so bit 1 of their
+  // addresses is free, as bit 0 is for the managed tag.
+  static constexpr std::uintptr_t _cell_tag = 2;
+
+  // From the top: 46 bits of block pointer (the address without its four
+  // zero bits, then the cell and managed tags), the generation, the local
+  // count.
+  static constexpr int _count_bits = 9;
+  static constexpr int _generation_bits = 9;
+  static constexpr int _pointer_shift = _count_bits + _generation_bits;
+  static constexpr std::uint64_t _count_mask =
+      (std::uint64_t{1} << _count_bits) - 1;
+  static constexpr std::uint64_t _generation_mask =
+      (std::uint64_t{1} << _generation_bits) - 1;
+
+  static constexpr std::uintptr_t _tags = _cell_tag | detail::arc_managed_tag;
+
+  static auto pack(std::uintptr_t bits,
+                   std::uint64_t generation,
+                   std::uint64_t count) noexcept -> std::uint64_t {
+    std::uint64_t pointer = (std::uint64_t{bits} >> 4 << 2) | (bits & _tags);
+    return (pointer << _pointer_shift) |
+           ((generation & _generation_mask) << _count_bits) | count;
+  }
+
+  static auto bits_of(std::uint64_t word) noexcept -> std::uintptr_t {
+    std::uint64_t pointer = word >> _pointer_shift;
+    return static_cast<std::uintptr_t>((pointer >> 2 << 4) |
+                                       (pointer & _tags));
+  }
+
+  // The bits to keep for value, which takes over its reference: its own, or
+  // a cell's if it is an aliasing arc.
+  static auto stow(arc<T> value) -> std::uintptr_t {
+    if constexpr (!std::is_array_v<T>) {
+      if (detail::arc_offset(value.bits()) != 0) {
+        auto* holder = new cell(std::move(value));
+        return reinterpret_cast<std::uintptr_t>(
+                   static_cast<detail::arc_block<atomic_count>*>(holder)) |
+               _cell_tag;
+      }
+    }
+    return std::move(value).into_bits();
+  }
+
+  // The arc that a strong reference on the block of bits stands for, taking
+  // over that reference.
+  static auto unstow(std::uintptr_t bits) noexcept -> arc<T> {
+    if constexpr (!std::is_array_v<T>) {
+      if (bits & _cell_tag) {
+        auto* holder = static_cast<cell*>(
+            detail::arc_counts<atomic_count>(bits));
+        arc<T> value = *holder->get();
+        detail::release_ref(holder);
+        return value;
+      }
+    }
+    return arc<T>::from_bits(bits);
+  }
+
+  // load(), also giving the pointer and generation of the word the value
+  // came from.
+  auto load(std::uint64_t& tag) const noexcept -> arc<T> {
+    std::uint64_t word = acquire_local();
+    tag = word >> _count_bits;
+    std::uintptr_t bits = bits_of(word);
+    if (bits) {
+      detail::arc_counts<atomic_count>(bits)->add_ref();
+    }
+    // Same block and generation: our local count is still in the word.
+    while (word >> _count_bits == tag) {
+      if (_word.compare_exchange_weak(word, word - 1,
+                                      std::memory_order_acq_rel)) {
+        return unstow(bits);
+      }
+    }
+    // A writer replaced the block and converted our local count into a
+    // strong reference of its own; drop it. It is never the last one, as the
+    // reference taken above is still held.
+    if (bits) {
+      detail::arc_counts<atomic_count>(bits)->drop_ref();
+    }
+    return unstow(bits);
+  }
+
+  // The word that replaces word with bits: the next generation, no loads.
+  static auto successor(std::uint64_t word, std::uintptr_t bits) noexcept
+      -> std::uint64_t {
+    return pack(bits, (word >> _count_bits) + 1, 0);
+  }
+
+  // Adds one to the local count and returns the new word.
+  auto acquire_local() const noexcept -> std::uint64_t {
+    std::uint64_t word = _word.load(std::memory_order_relaxed);
+    do {
+      while ((word & _count_mask) == _count_mask) [[unlikely]] {
+        std::this_thread::yield();
+        word = _word.load(std::memory_order_relaxed);
+      }
+    } while (!_word.compare_exchange_weak(word, word + 1,
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_relaxed));
+    return word + 1;
+  }
+
+  // Takes over the strong reference held by a word that was just swapped
+  // out, after crediting the loads still in flight on it.
+  static auto adopt(std::uint64_t word) noexcept -> arc<T> {
+    std::uintptr_t bits = bits_of(word);
+    if (bits && (word & _count_mask) != 0) {
+      detail::arc_counts<atomic_count>(bits)->add_ref(word & _count_mask);
+    }
+    return unstow(bits);
+  }
+
+  mutable std::atomic<std::uint64_t> _word;
+};
+
+}  // namespace stl
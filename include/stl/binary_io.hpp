@@ -0,0 +1,667 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <climits>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "arc.hpp"
+#include "arr.hpp"
+#include "vec.hpp"
+
+// Binary snapshots of trivially copyable element sequences. A file is a
+// 64-byte binary_header followed by the raw element bytes, so the payload
+// starts cache-line aligned and can be used in place from an mmap. Bytes are
+// stored in the writer's native order; a reader on a machine of the other
+// endianness rejects the file.
+namespace stl {
+
+// Streaming XXH64 (seed 0 by default), used as the payload checksum.
+class checksum64 {
+ public:
+  explicit checksum64(std::uint64_t seed = 0) noexcept
+      : _seed(seed),
+        _lanes{seed + prime1 + prime2, seed + prime2, seed, seed - prime1} {}
+
+  auto update(const void* data, std::size_t size) noexcept -> void {
+    auto* bytes = static_cast<const unsigned char*>(data);
+    _length += size;
+    if (_buffered != 0) {
+      std::size_t take = std::min(stripe_size - _buffered, size);
+      std::memcpy(_buffer + _buffered, bytes, take);
+      _buffered += take;
+      bytes += take;
+      size -= take;
+      if (_buffered < stripe_size) {
+        return;
+      }
+      stripe(_buffer);
+      _buffered = 0;
+    }
+    for (; size >= stripe_size; bytes += stripe_size, size -= stripe_size) {
+      stripe(bytes);
+    }
+    if (size != 0) {
+      std::memcpy(_buffer, bytes, size);
+    }
+    _buffered = size;
+  }
+
+  auto digest() const noexcept -> std::uint64_t {
+    std::uint64_t hash;
+    if (_length >= stripe_size) {
+      hash = std::rotl(_lanes[0], 1) + std::rotl(_lanes[1], 7) +
+             std::rotl(_lanes[2], 12) + std::rotl(_lanes[3], 18);
+      for (std::uint64_t lane : _lanes) {
+        hash = (hash ^ round(0, lane)) * prime1 + prime4;
+      }
+    } else {
+      hash = _seed + prime5;
+    }
+    hash += _length;
+
+    const unsigned char* tail = _buffer;
+    std::size_t left = _buffered;
+    for (; left >= 8; tail += 8, left -= 8) {
+      hash ^= round(0, load<std::uint64_t>(tail));
+      hash = std::rotl(hash, 27) * prime1 + prime4;
+    }
+    if (left >= 4) {
+      hash ^= load<std::uint32_t>(tail) * prime1;
+      hash = std::rotl(hash, 23) * prime2 + prime3;
+      tail += 4;
+      left -= 4;
+    }
+    for (; left > 0; ++tail, --left) {
+      hash ^= *tail * prime5;
+      hash = std::rotl(hash, 11) * prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+  }
+
+ private:
+  static constexpr std::uint64_t prime1 = 0x9E3779B185EBCA87;
+  static constexpr std::uint64_t prime2 = 0xC2B2AE3D27D4EB4F;
+  static constexpr std::uint64_t prime3 = 0x165667B19E3779F9;
+  static constexpr std::uint64_t prime4 = 0x85EBCA77C2B2AE63;
+  static constexpr std::uint64_t prime5 = 0x27D4EB2F165667C5;
+  static constexpr std::size_t stripe_size = 32;
+
+  template <typename Word>
+  static auto load(const unsigned char* bytes) noexcept -> std::uint64_t {
+    Word word;
+    std::memcpy(&word, bytes, sizeof(Word));
+    return word;
+  }
+
+  static auto round(std::uint64_t acc, std::uint64_t input) noexcept
+      -> std::uint64_t {
+    return std::rotl(acc + input * prime2, 31) * prime1;
+  }
+
+  auto stripe(const unsigned char* bytes) noexcept -> void {
+    for (std::size_t i = 0; i < 4; ++i) {
+      _lanes[i] = round(_lanes[i], load<std::uint64_t>(bytes + 8 * i));
+    }
+  }
+
+  std::uint64_t _seed;
+  std::uint64_t _lanes[4];
+  std::uint64_t _length{0};
+  unsigned char _buffer[stripe_size]{};
+  std::size_t _buffered{0};
+};
+
+// Identifies the element type of a file. The default encodes the kind of
+// type (unsigned, signed, floating point or other) with its size and
+// alignment, which is stable across compilers; specialize it to tell apart
+// distinct record types of the same shape.
+template <typename T>
+struct binary_type_tag {
+  static constexpr char kind = std::is_floating_point_v<T> ? 'f'
+                               : std::is_unsigned_v<T>     ? 'u'
+                               : std::is_integral_v<T>     ? 'i'
+                                                           : 'r';
+
+  static constexpr std::uint64_t value =
+      std::uint64_t{kind} << 56 | std::uint64_t{alignof(T)} << 32 | sizeof(T);
+};
+
+template <typename T>
+inline constexpr std::uint64_t binary_type_tag_v =
+    binary_type_tag<std::remove_cv_t<T>>::value;
+
+struct binary_header {
+  static constexpr std::uint32_t expected_magic = 0x424C5453;  // "STLB"
+  static constexpr std::uint32_t swapped_magic = 0x53544C42;
+  static constexpr std::uint16_t current_version = 1;
+
+  std::uint32_t magic;
+  std::uint16_t version;
+  std::uint16_t flags;
+  std::uint64_t type_tag;
+  std::uint64_t element_size;
+  std::uint64_t count;
+  std::uint64_t checksum;
+  std::byte reserved[24];
+};
+
+static_assert(sizeof(binary_header) == 64 &&
+                  std::is_trivially_copyable_v<binary_header>,
+              "binary_header must be a 64-byte trivially copyable record");
+
+namespace detail {
+
+template <typename R>
+concept binary_range =
+    std::ranges::contiguous_range<R> && std::ranges::sized_range<R> &&
+    std::is_trivially_copyable_v<std::ranges::range_value_t<R>>;
+
+template <typename T>
+auto make_header(std::uint64_t count, std::uint64_t checksum) noexcept
+    -> binary_header {
+  binary_header header{};
+  header.magic = binary_header::expected_magic;
+  header.version = binary_header::current_version;
+  header.type_tag = binary_type_tag_v<T>;
+  header.element_size = sizeof(T);
+  header.count = count;
+  header.checksum = checksum;
+  return header;
+}
+
+// Throws unless header describes a sequence of T.
+template <typename T>
+auto check_header(const binary_header& header, const char* what) -> void {
+  if (header.magic != binary_header::expected_magic) {
+    throw std::runtime_error(
+        header.magic == binary_header::swapped_magic
+            ? std::format("{}: file was written with the other byte order",
+                          what)
+            : std::format("{}: not a binary snapshot", what));
+  }
+  if (header.version != binary_header::current_version) {
+    throw std::runtime_error(std::format("{}: unsupported version {}", what,
+                                         header.version));
+  }
+  if (header.type_tag != binary_type_tag_v<T> ||
+      header.element_size != sizeof(T)) {
+    throw std::runtime_error(std::format(
+        "{}: element type mismatch (tag {:#x}, size {}; expected {:#x}, {})",
+        what, header.type_tag, header.element_size, binary_type_tag_v<T>,
+        sizeof(T)));
+  }
+}
+
+inline auto check_checksum(std::uint64_t expected,
+                           std::uint64_t actual,
+                           const char* what) -> void {
+  if (expected != actual) {
+    throw std::runtime_error(std::format(
+        "{}: checksum mismatch ({:#x} stored, {:#x} computed)", what,
+        expected, actual));
+  }
+}
+
+inline auto throw_errno(const char* what) -> void {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+// Writes every byte described by iov, resuming after partial writes.
+inline auto write_all(int fd, iovec* iov, int count, const char* what)
+    -> void {
+  while (count > 0) {
+    ssize_t written = ::writev(fd, iov, std::min(count, IOV_MAX));
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw_errno(what);
+    }
+    auto left = static_cast<std::size_t>(written);
+    while (count > 0 && left >= iov->iov_len) {
+      left -= iov->iov_len;
+      ++iov;
+      --count;
+    }
+    if (count > 0) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+      iov->iov_len -= left;
+    }
+  }
+}
+
+// Writes size bytes at offset, resuming after partial writes.
+inline auto pwrite_all(int fd, const void* data, std::size_t size,
+                       off_t offset, const char* what) -> void {
+  auto* bytes = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t written = ::pwrite(fd, bytes, size, offset);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw_errno(what);
+    }
+    bytes += written;
+    offset += written;
+    size -= static_cast<std::size_t>(written);
+  }
+}
+
+// Reads exactly size bytes; running out of file is an error.
+inline auto read_all(int fd, void* data, std::size_t size, const char* what)
+    -> void {
+  auto* bytes = static_cast<char*>(data);
+  while (size > 0) {
+    ssize_t got = ::read(fd, bytes, std::min<std::size_t>(size, SSIZE_MAX));
+    if (got < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw_errno(what);
+    }
+    if (got == 0) {
+      throw std::runtime_error(std::format("{}: file is truncated", what));
+    }
+    bytes += got;
+    size -= static_cast<std::size_t>(got);
+  }
+}
+
+// Throws unless the count in header, just read from fd, is representable
+// in memory and, for regular files, fits in the bytes after the header. This
+// runs before any storage is sized from the count, so a corrupt or truncated
+// file fails cleanly instead of triggering a huge allocation. Pipes and
+// sockets have no known length and only get the first check.
+template <typename T>
+auto check_count(int fd, const binary_header& header, const char* what)
+    -> void {
+  if (header.count > SIZE_MAX / sizeof(T)) {
+    throw std::runtime_error(std::format(
+        "{}: element count {} is too large", what, header.count));
+  }
+  struct stat info {};
+  if (::fstat(fd, &info) < 0) {
+    throw_errno(what);
+  }
+  if (!S_ISREG(info.st_mode)) {
+    return;
+  }
+  off_t position = ::lseek(fd, 0, SEEK_CUR);
+  if (position < 0) {
+    throw_errno(what);
+  }
+  auto left = static_cast<std::uint64_t>(std::max<off_t>(
+      info.st_size - position, 0));
+  if (header.count > left / sizeof(T)) {
+    throw std::runtime_error(std::format(
+        "{}: file is truncated ({} elements in the header, room for {})",
+        what, header.count, left / sizeof(T)));
+  }
+}
+
+// Payloads are read and checksummed in slices of this size, so each slice
+// is hashed while it is still in cache.
+inline constexpr std::size_t read_slice = std::size_t{4} << 20;
+
+// Reads header.count elements into dest and verifies the checksum.
+template <typename T>
+auto read_payload(int fd, const binary_header& header, T* dest,
+                  const char* what) -> void {
+  auto* bytes = reinterpret_cast<char*>(dest);
+  std::size_t size = header.count * sizeof(T);
+  checksum64 sum;
+  for (std::size_t done = 0; done < size;) {
+    std::size_t slice = std::min(read_slice, size - done);
+    read_all(fd, bytes + done, slice, what);
+    sum.update(bytes + done, slice);
+    done += slice;
+  }
+  check_checksum(header.checksum, sum.digest(), what);
+}
+
+class file_descriptor {
+ public:
+  file_descriptor(const std::filesystem::path& path, int flags,
+                  const char* what)
+      : _fd(::open(path.c_str(), flags | O_CLOEXEC, 0644)) {
+    if (_fd < 0) {
+      throw_errno(what);
+    }
+  }
+
+  file_descriptor(const file_descriptor&) = delete;
+
+  ~file_descriptor() {
+    ::close(_fd);
+  }
+
+  auto operator=(const file_descriptor&) -> file_descriptor& = delete;
+
+  auto get() const noexcept -> int {
+    return _fd;
+  }
+
+ private:
+  int _fd;
+};
+
+}  // namespace detail
+
+// Writes values (a vec, arr, span, ...) to fd as header plus payload with a
+// single writev.
+template <detail::binary_range R>
+auto write_binary(int fd, const R& values) -> void {
+  using T = std::ranges::range_value_t<R>;
+  const T* data = std::ranges::data(values);
+  std::size_t count = std::ranges::size(values);
+  checksum64 sum;
+  sum.update(data, count * sizeof(T));
+  binary_header header = detail::make_header<T>(count, sum.digest());
+  iovec iov[2] = {{&header, sizeof(header)},
+                  {const_cast<T*>(data), count * sizeof(T)}};
+  detail::write_all(fd, iov, 2, "write_binary");
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+auto write_binary(int fd, const arc<T[]>& values) -> void {
+  write_binary(fd, std::span<const T>(values.get(), values.size()));
+}
+
+// Reads and validates the header of a file holding T elements, including
+// its count against the bytes left in the file.
+template <typename T>
+auto read_binary_header(int fd) -> binary_header {
+  binary_header header;
+  detail::read_all(fd, &header, sizeof(header), "read_binary");
+  detail::check_header<T>(header, "read_binary");
+  detail::check_count<T>(fd, header, "read_binary");
+  return header;
+}
+
+// Replaces the contents of values with the sequence stored at fd. The
+// payload is read straight into the vec's storage.
+template <typename T, typename Allocator, typename Growth>
+  requires std::is_trivially_copyable_v<T>
+auto read_binary(int fd, vec<T, Allocator, Growth>& values) -> void {
+  binary_header header = read_binary_header<T>(fd);
+  values.clear();
+  values.resize_for_overwrite(header.count);
+  try {
+    detail::read_payload(fd, header, values.data(), "read_binary");
+  } catch (...) {
+    values.clear();
+    throw;
+  }
+}
+
+// Fills values, whose size must match the stored count.
+template <typename T, std::size_t N>
+  requires std::is_trivially_copyable_v<T>
+auto read_binary(int fd, arr<T, N>& values) -> void {
+  binary_header header = read_binary_header<T>(fd);
+  if (header.count != N) {
+    throw std::runtime_error(std::format(
+        "read_binary: file holds {} elements, arr holds {}", header.count, N));
+  }
+  detail::read_payload(fd, header, values.data(), "read_binary");
+}
+
+// Replaces values with a fresh array holding the stored sequence.
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+auto read_binary(int fd, arc<T[]>& values) -> void {
+  binary_header header = read_binary_header<T>(fd);
+  arc<T[]> result(header.count, for_overwrite);
+  detail::read_payload(fd, header, result.get(), "read_binary");
+  values = std::move(result);
+}
+
+template <typename Values>
+auto save_binary(const std::filesystem::path& path, const Values& values)
+    -> void {
+  detail::file_descriptor file(path, O_WRONLY | O_CREAT | O_TRUNC,
+                               "save_binary");
+  write_binary(file.get(), values);
+}
+
+template <typename Values>
+auto load_binary(const std::filesystem::path& path, Values& values) -> void {
+  detail::file_descriptor file(path, O_RDONLY, "load_binary");
+  read_binary(file.get(), values);
+}
+
+// Read-only view of a snapshot file mapped into memory. Elements are used in
+// place; nothing is copied. The checksum is not verified on open, since
+// that would touch every page; call verify() when integrity matters more
+// than open latency.
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+class binary_view {
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using const_iterator = const T*;
+
+  static auto open(const std::filesystem::path& path) -> binary_view {
+    detail::file_descriptor file(path, O_RDONLY, "binary_view::open");
+    struct stat info {};
+    if (::fstat(file.get(), &info) < 0) {
+      detail::throw_errno("binary_view::open");
+    }
+    auto length = static_cast<std::size_t>(info.st_size);
+    if (length < sizeof(binary_header)) {
+      throw std::runtime_error("binary_view::open: file is truncated");
+    }
+    void* mapped =
+        ::mmap(nullptr, length, PROT_READ, MAP_SHARED, file.get(), 0);
+    if (mapped == MAP_FAILED) {
+      detail::throw_errno("binary_view::open");
+    }
+    binary_view view(mapped, length);
+    detail::check_header<T>(view.header(), "binary_view::open");
+    if (view.header().count >
+        (length - sizeof(binary_header)) / sizeof(T)) {
+      throw std::runtime_error("binary_view::open: file is truncated");
+    }
+    return view;
+  }
+
+  binary_view(const binary_view&) = delete;
+
+  binary_view(binary_view&& other) noexcept
+      : _map(std::exchange(other._map, nullptr)),
+        _length(std::exchange(other._length, 0)) {}
+
+  ~binary_view() {
+    if (_map) {
+      ::munmap(_map, _length);
+    }
+  }
+
+  auto operator=(const binary_view&) -> binary_view& = delete;
+
+  auto operator=(binary_view&& other) noexcept -> binary_view& {
+    if (this != &other) {
+      if (_map) {
+        ::munmap(_map, _length);
+      }
+      _map = std::exchange(other._map, nullptr);
+      _length = std::exchange(other._length, 0);
+    }
+    return *this;
+  }
+
+  auto header() const noexcept -> const binary_header& {
+    return *static_cast<const binary_header*>(_map);
+  }
+
+  auto data() const noexcept -> const T* {
+    return reinterpret_cast<const T*>(static_cast<const char*>(_map) +
+                                      sizeof(binary_header));
+  }
+
+  auto size() const noexcept -> size_type {
+    return header().count;
+  }
+
+  auto empty() const noexcept -> bool {
+    return size() == 0;
+  }
+
+  auto operator[](size_type pos) const noexcept -> const T& {
+    return data()[pos];
+  }
+
+  auto begin() const noexcept -> const_iterator {
+    return data();
+  }
+
+  auto end() const noexcept -> const_iterator {
+    return data() + size();
+  }
+
+  auto span() const noexcept -> std::span<const T> {
+    return {data(), size()};
+  }
+
+  // Recomputes the payload checksum and compares it with the header's.
+  auto verify() const noexcept -> bool {
+    checksum64 sum;
+    sum.update(data(), size() * sizeof(T));
+    return sum.digest() == header().checksum;
+  }
+
+ private:
+  binary_view(void* map, std::size_t length) noexcept
+      : _map(map), _length(length) {}
+
+  void* _map;
+  std::size_t _length;
+};
+
+// Writes a snapshot piece by piece, for payloads that are produced
+// incrementally or do not fit in memory. The header is written up front
+// with a zero count and rewritten by finish() once count and checksum are
+// known, so fd must be seekable.
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+class binary_writer {
+ public:
+  explicit binary_writer(int fd) : _fd(fd) {
+    binary_header header = detail::make_header<T>(0, 0);
+    iovec iov[1] = {{&header, sizeof(header)}};
+    _origin = ::lseek(_fd, 0, SEEK_CUR);
+    if (_origin < 0) {
+      detail::throw_errno("binary_writer");
+    }
+    detail::write_all(_fd, iov, 1, "binary_writer");
+  }
+
+  binary_writer(const binary_writer&) = delete;
+
+  auto operator=(const binary_writer&) -> binary_writer& = delete;
+
+  auto write(std::span<const T> chunk) -> void {
+    _sum.update(chunk.data(), chunk.size_bytes());
+    iovec iov[1] = {{const_cast<T*>(chunk.data()), chunk.size_bytes()}};
+    detail::write_all(_fd, iov, 1, "binary_writer::write");
+    _count += chunk.size();
+  }
+
+  auto count() const noexcept -> std::uint64_t {
+    return _count;
+  }
+
+  // Completes the header. The file is not a valid snapshot before this.
+  auto finish() -> void {
+    binary_header header = detail::make_header<T>(_count, _sum.digest());
+    detail::pwrite_all(_fd, &header, sizeof(header), _origin,
+                       "binary_writer::finish");
+  }
+
+ private:
+  int _fd;
+  off_t _origin{0};
+  std::uint64_t _count{0};
+  checksum64 _sum;
+};
+
+// Reads a snapshot piece by piece into caller-provided buffers. The
+// checksum is verified when the last element has been read, or on
+// construction for an empty snapshot.
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+class binary_reader {
+ public:
+  explicit binary_reader(int fd)
+      : _fd(fd), _header(read_binary_header<T>(fd)) {
+    if (_header.count == 0) {
+      detail::check_checksum(_header.checksum, _sum.digest(), "binary_reader");
+    }
+  }
+
+  binary_reader(const binary_reader&) = delete;
+
+  auto operator=(const binary_reader&) -> binary_reader& = delete;
+
+  auto header() const noexcept -> const binary_header& {
+    return _header;
+  }
+
+  // Elements not yet read.
+  auto remaining() const noexcept -> std::uint64_t {
+    return _header.count - _read;
+  }
+
+  // Fills the front of chunk with up to chunk.size() elements and returns
+  // how many were read; 0 means the end of the snapshot.
+  auto read(std::span<T> chunk) -> std::size_t {
+    std::size_t count =
+        static_cast<std::size_t>(std::min<std::uint64_t>(chunk.size(),
+                                                         remaining()));
+    detail::read_all(_fd, chunk.data(), count * sizeof(T),
+                     "binary_reader::read");
+    _sum.update(chunk.data(), count * sizeof(T));
+    _read += count;
+    if (count != 0 && remaining() == 0) {
+      detail::check_checksum(_header.checksum, _sum.digest(),
+                             "binary_reader::read");
+    }
+    return count;
+  }
+
+ private:
+  int _fd;
+  binary_header _header;
+  std::uint64_t _read{0};
+  checksum64 _sum;
+};
+
+}  // namespace stl
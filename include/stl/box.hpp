@@ -1,12 +1,26 @@
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <memory>
 #include <type_traits>
 #include <utility>
 
+#include "allocator.hpp"
+#include "instrument.hpp"
+#include "relocate.hpp"
+
 namespace stl {
 
+// Tag selecting default-initialization: trivial types are left
+// uninitialized instead of being zeroed.
+struct for_overwrite_t {
+  explicit for_overwrite_t() = default;
+};
+
+inline constexpr for_overwrite_t for_overwrite{};
+
 template <typename T, typename Deleter = std::default_delete<T>>
 class box {
  public:
@@ -14,11 +28,21 @@ class box {
   using element_type = T;
   using deleter_type = Deleter;
 
-  explicit box(pointer ptr = nullptr) noexcept : _object(ptr) {}
+  explicit box(pointer ptr = nullptr) noexcept : _object(ptr) {
+    if (_object) {
+      instrument::on_allocate<box>(sizeof(T));
+    }
+  }
 
   template <typename... Args>
   explicit box(std::in_place_t, Args&&... args) {
     _object = new T(std::forward<Args>(args)...);
+    instrument::on_allocate<box>(sizeof(T));
+  }
+
+  explicit box(for_overwrite_t) {
+    _object = new T;
+    instrument::on_allocate<box>(sizeof(T));
   }
 
   box(const box&) = delete;
@@ -31,12 +55,21 @@ class box {
 
   auto reset(pointer ptr = nullptr) -> void {
     if (_object) {
+      instrument::on_deallocate<box>(sizeof(T));
       Deleter{}(_object);
     }
+    if (ptr) {
+      instrument::on_allocate<box>(sizeof(T));
+    }
     _object = ptr;
   }
 
+  // The pointer leaves box's accounting as an adopted one enters it, so
+  // counters see it freed here rather than live forever.
   auto release() noexcept -> pointer {
+    if (_object) {
+      instrument::on_deallocate<box>(sizeof(T));
+    }
     return std::exchange(_object, nullptr);
   }
 
@@ -77,10 +110,20 @@ class box<T[], Deleter> {
   using element_type = T;
   using deleter_type = Deleter;
 
-  explicit box(pointer ptr = nullptr) noexcept : _object(ptr) {}
+  explicit box(pointer ptr = nullptr) noexcept : _object(ptr) {
+    if (_object) {
+      instrument::on_allocate<box>(0);
+    }
+  }
 
   explicit box(std::size_t size) {
     _object = new T[size]();
+    instrument::on_allocate<box>(0);
+  }
+
+  box(std::size_t size, for_overwrite_t) {
+    _object = new T[size];
+    instrument::on_allocate<box>(0);
   }
 
   box(const box&) = delete;
@@ -91,14 +134,24 @@ class box<T[], Deleter> {
     reset();
   }
 
+  // The array length is not kept, so frees cannot report their bytes. All
+  // events of box<T[]> are therefore counted without bytes, which keeps
+  // bytes_allocated and bytes_deallocated balanced.
   auto reset(pointer ptr = nullptr) -> void {
     if (_object) {
+      instrument::on_deallocate<box>(0);
       Deleter{}(_object);
     }
+    if (ptr) {
+      instrument::on_allocate<box>(0);
+    }
     _object = ptr;
   }
 
   auto release() noexcept -> pointer {
+    if (_object) {
+      instrument::on_deallocate<box>(0);
+    }
     return std::exchange(_object, nullptr);
   }
 
@@ -132,6 +185,59 @@ class box<T[], Deleter> {
   pointer _object;
 };
 
+// Deleter for arrays obtained from make_box_aligned. The element count is
+// stored in a header just below the first element so that the deleter can
+// destroy the elements and return the exact block size to the allocator.
+template <typename T,
+          std::size_t Align = alignof(T),
+          page_mode Pages = page_mode::standard>
+struct aligned_delete;
+
+template <typename T, std::size_t Align, page_mode Pages>
+struct aligned_delete<T[], Align, Pages> {
+  static constexpr std::size_t alignment = std::max(Align, alignof(T));
+
+  // Elements sit header bytes into the block, a multiple of alignment, so
+  // the block itself must be aligned to at least alignof(T) too.
+  using allocator_type = stl::allocator<std::byte, alignment, Pages>;
+  static constexpr std::size_t header =
+      (sizeof(std::size_t) + alignment - 1) & ~(alignment - 1);
+
+  static auto allocate(std::size_t size) -> T* {
+    std::byte* base = allocator_type{}.allocate(header + size * sizeof(T));
+    std::memcpy(base + header - sizeof(std::size_t), &size,
+                sizeof(std::size_t));
+    return reinterpret_cast<T*>(base + header);
+  }
+
+  static auto deallocate(T* ptr) noexcept -> void {
+    std::byte* base = reinterpret_cast<std::byte*>(ptr) - header;
+    allocator_type{}.deallocate(base, header + count(ptr) * sizeof(T));
+  }
+
+  static auto count(T* ptr) noexcept -> std::size_t {
+    std::size_t size;
+    std::memcpy(&size,
+                reinterpret_cast<std::byte*>(ptr) - sizeof(std::size_t),
+                sizeof(std::size_t));
+    return size;
+  }
+
+  auto operator()(T* ptr) const noexcept -> void {
+    std::destroy_n(ptr, count(ptr));
+    deallocate(ptr);
+  }
+};
+
+template <typename T,
+          std::size_t Align = cache_line_size,
+          page_mode Pages = page_mode::standard>
+using aligned_box = box<T, aligned_delete<T, Align, Pages>>;
+
+template <typename T, typename Deleter>
+struct is_trivially_relocatable<box<T, Deleter>>
+    : is_trivially_relocatable<Deleter> {};
+
 template <typename T>
 auto make_box(std::size_t size) -> box<T>
   requires std::is_unbounded_array_v<T>
@@ -146,4 +252,58 @@ auto make_box(Args&&... args) -> box<T>
   return box<T>(std::in_place, std::forward<Args>(args)...);
 }
 
+template <typename T>
+auto make_box_for_overwrite(std::size_t size) -> box<T>
+  requires std::is_unbounded_array_v<T>
+{
+  return box<T>(size, for_overwrite);
+}
+
+template <typename T>
+auto make_box_for_overwrite() -> box<T>
+  requires(!std::is_array_v<T>)
+{
+  return box<T>(for_overwrite);
+}
+
+// Allocates a value-initialized array whose first element is Align-byte
+// aligned. With Pages other than standard, arrays of 2 MiB and more are backed
+// by huge pages.
+template <typename T,
+          std::size_t Align = cache_line_size,
+          page_mode Pages = page_mode::standard>
+auto make_box_aligned(std::size_t size) -> aligned_box<T, Align, Pages>
+  requires std::is_unbounded_array_v<T>
+{
+  using deleter = aligned_delete<T, Align, Pages>;
+  using element = std::remove_extent_t<T>;
+  element* ptr = deleter::allocate(size);
+  try {
+    std::uninitialized_value_construct_n(ptr, size);
+  } catch (...) {
+    deleter::deallocate(ptr);
+    throw;
+  }
+  return aligned_box<T, Align, Pages>(ptr);
+}
+
+template <typename T,
+          std::size_t Align = cache_line_size,
+          page_mode Pages = page_mode::standard>
+auto make_box_aligned(std::size_t size, for_overwrite_t)
+    -> aligned_box<T, Align, Pages>
+  requires std::is_unbounded_array_v<T>
+{
+  using deleter = aligned_delete<T, Align, Pages>;
+  using element = std::remove_extent_t<T>;
+  element* ptr = deleter::allocate(size);
+  try {
+    std::uninitialized_default_construct_n(ptr, size);
+  } catch (...) {
+    deleter::deallocate(ptr);
+    throw;
+  }
+  return aligned_box<T, Align, Pages>(ptr);
+}
+
 }  // namespace stl
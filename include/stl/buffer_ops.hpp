@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+
+#include "relocate.hpp"
+#include "simd.hpp"
+
+namespace stl {
+
+namespace detail {
+
+// Element algorithms on the raw buffer of a contiguous container, shared by
+// vec and small_vec. Each takes the container's allocator and goes through
+// allocator_traits unless the allocator customizes neither construct nor
+// destroy, in which case the bulk uninitialized-memory algorithms are used.
+// Buffers are plain pointers; allocating and freeing them, and keeping the
+// container's size and capacity, is left to the container.
+template <typename T, typename Allocator>
+struct buffer_ops {
+  using alloc_traits = std::allocator_traits<Allocator>;
+  using size_type = std::size_t;
+  using pointer = T*;
+
+  // Allocators that customize neither construct nor destroy (std::allocator
+  // and most arena allocators) get the bulk uninitialized-memory algorithms,
+  // which lower to memset/memcpy for trivial types. Everything else, notably
+  // std::pmr::polymorphic_allocator, goes through allocator_traits so that
+  // uses-allocator construction is honoured.
+  static constexpr bool plain_construct =
+      !requires(Allocator& alloc, T* ptr) { alloc.construct(ptr); } &&
+      !requires(Allocator& alloc, T* ptr) { alloc.destroy(ptr); };
+
+  static auto destroy_n(Allocator& alloc, pointer first,
+                        size_type count) noexcept -> void {
+    if constexpr (plain_construct) {
+      std::destroy_n(first, count);
+    } else {
+      for (size_type i = 0; i < count; ++i) {
+        alloc_traits::destroy(alloc, first + i);
+      }
+    }
+  }
+
+  // Constructs count elements at dest by invoking make(slot) for each slot,
+  // destroying the already-constructed prefix if one of them throws.
+  template <typename Make>
+  static auto construct_each(Allocator& alloc, pointer dest, size_type count,
+                             Make make) -> void {
+    size_type built = 0;
+    try {
+      for (; built < count; ++built) {
+        make(dest + built);
+      }
+    } catch (...) {
+      destroy_n(alloc, dest, built);
+      throw;
+    }
+  }
+
+  static auto value_construct_n(Allocator& alloc, pointer dest,
+                                size_type count) -> void {
+    if constexpr (plain_construct) {
+      std::uninitialized_value_construct_n(dest, count);
+    } else {
+      construct_each(alloc, dest, count, [&alloc](pointer slot) {
+        alloc_traits::construct(alloc, slot);
+      });
+    }
+  }
+
+  static auto default_construct_n(Allocator& alloc, pointer dest,
+                                  size_type count) -> void {
+    if constexpr (std::is_trivially_default_constructible_v<T>) {
+      // Nothing to do: the storage is raw and T needs no initialization.
+    } else if constexpr (plain_construct) {
+      std::uninitialized_default_construct_n(dest, count);
+    } else {
+      value_construct_n(alloc, dest, count);
+    }
+  }
+
+  static auto fill_construct_n(Allocator& alloc, pointer dest, size_type count,
+                               const T& value) -> void {
+    if constexpr (plain_construct && simd::vectorizable<T>) {
+      simd::fill(dest, count, value);
+    } else if constexpr (plain_construct) {
+      std::uninitialized_fill_n(dest, count, value);
+    } else {
+      construct_each(alloc, dest, count, [&alloc, &value](pointer slot) {
+        alloc_traits::construct(alloc, slot, value);
+      });
+    }
+  }
+
+  template <typename InputIt>
+  static auto copy_construct_n(Allocator& alloc, InputIt first,
+                               size_type count, pointer dest) -> void {
+    if constexpr (plain_construct) {
+      std::uninitialized_copy_n(first, count, dest);
+    } else {
+      construct_each(alloc, dest, count, [&alloc, &first](pointer slot) {
+        alloc_traits::construct(alloc, slot, *first);
+        ++first;
+      });
+    }
+  }
+
+  static auto move_construct_n(Allocator& alloc, pointer first,
+                               size_type count, pointer dest) -> void {
+    copy_construct_n(alloc, std::make_move_iterator(first), count, dest);
+  }
+
+  // Constructs count elements at dest from those at first. Trivially
+  // relocatable elements are relocated bytewise, leaving the source dead;
+  // otherwise they are moved when that cannot throw and copied when it can,
+  // leaving the source alive until release_transferred.
+  static auto transfer_n(Allocator& alloc, pointer first, size_type count,
+                         pointer dest) -> void {
+    if constexpr (is_trivially_relocatable_v<T>) {
+      stl::relocate_n(first, count, dest);
+    } else if constexpr (std::is_nothrow_move_constructible_v<T> ||
+                         !std::copy_constructible<T>) {
+      move_construct_n(alloc, first, count, dest);
+    } else {
+      copy_construct_n(alloc, first, count, dest);
+    }
+  }
+
+  static auto release_transferred(Allocator& alloc, pointer first,
+                                  size_type count) noexcept -> void {
+    if constexpr (!is_trivially_relocatable_v<T>) {
+      destroy_n(alloc, first, count);
+    }
+  }
+
+  // The growth path of an insertion: fills new_buffer with the size
+  // elements of buffer and count new ones, made by make(slot), in front of
+  // the element at index. The new elements are built before the old ones
+  // are touched, so make may read from buffer. On success the caller
+  // releases buffer with release_transferred; on failure new_buffer holds
+  // nothing and buffer is unchanged.
+  template <typename Make>
+  static auto insert_into(Allocator& alloc, pointer buffer, size_type size,
+                          size_type index, size_type count, pointer new_buffer,
+                          Make make) -> void {
+    pointer gap = new_buffer + index;
+    construct_each(alloc, gap, count, make);
+    try {
+      transfer_n(alloc, buffer, index, new_buffer);
+    } catch (...) {
+      destroy_n(alloc, gap, count);
+      throw;
+    }
+    try {
+      transfer_n(alloc, buffer + index, size - index, gap + count);
+    } catch (...) {
+      destroy_n(alloc, new_buffer, index + count);
+      throw;
+    }
+  }
+
+  // Inserts count elements made by make(slot) in front of the element at
+  // index of a buffer with room for them. Trivially relocatable tails are
+  // shifted with one memmove; others are built at the end and rotated into
+  // place. make must not read from the buffer.
+  template <typename Make>
+  static auto insert_in_place(Allocator& alloc, pointer buffer, size_type size,
+                              size_type index, size_type count, Make make)
+      -> void {
+    if constexpr (is_trivially_relocatable_v<T>) {
+      pointer gap = buffer + index;
+      stl::relocate_overlapping_n(gap, size - index, gap + count);
+      try {
+        construct_each(alloc, gap, count, make);
+      } catch (...) {
+        stl::relocate_overlapping_n(gap + count, size - index, gap);
+        throw;
+      }
+    } else {
+      construct_each(alloc, buffer + size, count, make);
+      std::rotate(buffer + index, buffer + size, buffer + size + count);
+    }
+  }
+
+  // Removes the count elements starting at index, closing the gap.
+  static auto erase_n(Allocator& alloc, pointer buffer, size_type size,
+                      size_type index, size_type count) -> void {
+    pointer gap = buffer + index;
+    pointer end = buffer + size;
+    if constexpr (is_trivially_relocatable_v<T>) {
+      destroy_n(alloc, gap, count);
+      stl::relocate_overlapping_n(gap + count, end - (gap + count), gap);
+    } else {
+      std::move(gap + count, end, gap);
+      destroy_n(alloc, end - count, count);
+    }
+  }
+
+  // Removes the element at index by moving the last element into its place.
+  static auto swap_remove(Allocator& alloc, pointer buffer, size_type size,
+                          size_type index) -> void {
+    pointer hole = buffer + index;
+    pointer last = buffer + size - 1;
+    if constexpr (is_trivially_relocatable_v<T>) {
+      destroy_n(alloc, hole, 1);
+      if (hole != last) {
+        stl::relocate_n(last, 1, hole);
+      }
+    } else {
+      if (hole != last) {
+        *hole = std::move(*last);
+      }
+      destroy_n(alloc, last, 1);
+    }
+  }
+};
+
+// Removes every element of values matching pred in a single compacting pass
+// and returns how many were removed.
+template <typename Container, typename Pred>
+auto erase_if_compacting(Container& values, Pred pred) ->
+    typename Container::size_type {
+  auto first = std::remove_if(values.begin(), values.end(), pred);
+  auto removed =
+      static_cast<typename Container::size_type>(values.end() - first);
+  values.erase(first, values.end());
+  return removed;
+}
+
+}  // namespace detail
+
+}  // namespace stl
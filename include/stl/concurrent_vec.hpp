@@ -0,0 +1,415 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <format>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "allocator.hpp"
+
+namespace stl {
+
+// Append-only vector that many threads may push to at once. Elements live in
+// segments of first_segment, 2 * first_segment, 4 * first_segment, ...
+// slots; segments are never moved, so references stay valid for the life of
+// the container. A push makes sure the segments a little past the last
+// claimed slot exist, claims a slot with one fetch_add, constructs the
+// element and sets the slot's ready flag. Writers never wait for one
+// another. size() covers the longest prefix of ready slots, so readers may
+// index anything below it while pushes are in flight; a slot still being
+// constructed only delays the slots after it from showing up in size().
+//
+// Nothing can fail once a slot is claimed. Segments are allocated ahead of
+// the claims, and elements whose constructor may throw are built first and
+// then moved in, so no claimed slot is left unconstructed.
+template <typename T, typename Allocator = stl::allocator<T>>
+  requires std::is_nothrow_move_constructible_v<T>
+class concurrent_vec {
+  using alloc_traits = std::allocator_traits<Allocator>;
+
+  static_assert(std::is_same_v<typename alloc_traits::value_type, T>,
+                "concurrent_vec: Allocator::value_type must match T");
+  static_assert(std::is_same_v<typename alloc_traits::pointer, T*>,
+                "concurrent_vec: fancy allocator pointers are not supported");
+
+  template <bool Const>
+  class basic_iterator;
+
+ public:
+  using value_type = T;
+  using allocator_type = Allocator;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
+  using iterator = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+
+  static constexpr size_type first_segment = 32;
+
+  concurrent_vec() noexcept(noexcept(Allocator()))
+      : concurrent_vec(Allocator()) {}
+
+  explicit concurrent_vec(const Allocator& alloc) noexcept : _alloc(alloc) {}
+
+  concurrent_vec(const concurrent_vec&) = delete;
+
+  // Must not run concurrently with any other member.
+  ~concurrent_vec() {
+    clear();
+    for (size_type k = 0; k < _segment_count; ++k) {
+      if (pointer segment = _segments[k].load(std::memory_order_relaxed)) {
+        alloc_traits::deallocate(_alloc, segment, allocation_size(k));
+      }
+    }
+  }
+
+  auto operator=(const concurrent_vec&) -> concurrent_vec& = delete;
+
+  auto get_allocator() const noexcept -> allocator_type {
+    return _alloc;
+  }
+
+  // The element at pos, which must be below a size() the caller observed.
+  auto operator[](size_type pos) noexcept -> reference {
+    return *slot(pos);
+  }
+
+  auto operator[](size_type pos) const noexcept -> const_reference {
+    return *slot(pos);
+  }
+
+  auto at(size_type pos) -> reference {
+    check(pos);
+    return *slot(pos);
+  }
+
+  auto at(size_type pos) const -> const_reference {
+    check(pos);
+    return *slot(pos);
+  }
+
+  // Iteration covers the elements published when begin()/end() are called.
+  auto begin() noexcept -> iterator {
+    return iterator(this, 0);
+  }
+
+  auto begin() const noexcept -> const_iterator {
+    return const_iterator(this, 0);
+  }
+
+  auto end() noexcept -> iterator {
+    return iterator(this, size());
+  }
+
+  auto end() const noexcept -> const_iterator {
+    return const_iterator(this, size());
+  }
+
+  auto empty() const noexcept -> bool {
+    return size() == 0;
+  }
+
+  // Number of published elements: the slots before the first one that is
+  // not ready yet. Advances the shared hint so that later calls resume the
+  // scan where this one stopped.
+  auto size() const noexcept -> size_type {
+    size_type hint = _size.load(std::memory_order_acquire);
+    size_type claimed = _claimed.load(std::memory_order_relaxed);
+    size_type count = hint;
+    while (count < claimed && ready(count)) {
+      ++count;
+    }
+    while (hint < count && !_size.compare_exchange_weak(
+                               hint, count, std::memory_order_release,
+                               std::memory_order_relaxed)) {
+    }
+    return count;
+  }
+
+  // Allocates the segments needed to hold count elements. Safe to call
+  // concurrently with pushes.
+  auto reserve(size_type count) -> void {
+    if (count != 0) {
+      for (size_type k = 0; k <= segment_of(count - 1); ++k) {
+        segment(k);
+      }
+    }
+  }
+
+  auto push_back(const T& value) -> reference {
+    return emplace_back(value);
+  }
+
+  auto push_back(T&& value) -> reference {
+    return emplace_back(std::move(value));
+  }
+
+  // Appends an element and returns a reference to it. The element is
+  // published, and therefore visible through size(), once every earlier
+  // slot has been constructed too. Never waits for other writers.
+  template <typename... Args>
+    requires std::is_constructible_v<T, Args...>
+  auto emplace_back(Args&&... args) -> reference {
+    if constexpr (std::is_nothrow_constructible_v<T, Args...>) {
+      return claim_and_construct(std::forward<Args>(args)...);
+    } else {
+      T value(std::forward<Args>(args)...);
+      return claim_and_construct(std::move(value));
+    }
+  }
+
+  // Destroys every element but keeps the segments. Must not run
+  // concurrently with any other member.
+  auto clear() noexcept -> void {
+    size_type count = _claimed.load(std::memory_order_relaxed);
+    for (size_type i = 0; i < count; ++i) {
+      alloc_traits::destroy(_alloc, slot(i));
+      flag(i)->store(false, std::memory_order_relaxed);
+    }
+    _claimed.store(0, std::memory_order_relaxed);
+    _size.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr size_type _first_bits = std::countr_zero(first_segment);
+  static constexpr size_type _segment_count =
+      std::numeric_limits<size_type>::digits - _first_bits;
+
+  static_assert(std::has_single_bit(first_segment),
+                "concurrent_vec: first_segment must be a power of two");
+
+  // Slot i lives in segment k, which holds first_segment << k slots and
+  // starts at index first_segment * (2^k - 1).
+  static constexpr auto segment_of(size_type pos) noexcept -> size_type {
+    return std::bit_width(pos + first_segment) - 1 - _first_bits;
+  }
+
+  static constexpr auto segment_size(size_type k) noexcept -> size_type {
+    return first_segment << k;
+  }
+
+  static constexpr auto segment_start(size_type k) noexcept -> size_type {
+    return segment_size(k) - first_segment;
+  }
+
+  auto slot(size_type pos) const noexcept -> pointer {
+    size_type k = segment_of(pos);
+    return _segments[k].load(std::memory_order_acquire) + pos -
+           segment_start(k);
+  }
+
+  // A segment's allocation holds its slots followed by one ready flag per
+  // slot, rounded up to whole elements.
+  static constexpr auto allocation_size(size_type k) noexcept -> size_type {
+    return segment_size(k) + (segment_size(k) + sizeof(T) - 1) / sizeof(T);
+  }
+
+  static auto flags(pointer segment, size_type k) noexcept
+      -> std::atomic<bool>* {
+    return reinterpret_cast<std::atomic<bool>*>(segment + segment_size(k));
+  }
+
+  // The ready flag of slot pos, whose segment must exist.
+  auto flag(size_type pos) const noexcept -> std::atomic<bool>* {
+    size_type k = segment_of(pos);
+    return flags(_segments[k].load(std::memory_order_acquire), k) + pos -
+           segment_start(k);
+  }
+
+  // Whether slot pos holds a constructed element. Its segment may not have
+  // been installed yet, in which case it does not.
+  auto ready(size_type pos) const noexcept -> bool {
+    size_type k = segment_of(pos);
+    pointer segment = _segments[k].load(std::memory_order_acquire);
+    return segment && flags(segment, k)[pos - segment_start(k)].load(
+                          std::memory_order_acquire);
+  }
+
+  auto check(size_type pos) const -> void {
+    if (size_type count = size(); pos >= count) {
+      throw std::out_of_range(std::format(
+          "concurrent_vec::at: position {} out of range {}", pos, count));
+    }
+  }
+
+  // Returns segment k, installing a fresh one if no thread has yet. Losers
+  // of the installation race free their block and use the winner's.
+  auto segment(size_type k) -> pointer {
+    pointer current = _segments[k].load(std::memory_order_acquire);
+    if (current) {
+      return current;
+    }
+    pointer fresh = alloc_traits::allocate(_alloc, allocation_size(k));
+    std::atomic<bool>* ready_flags = flags(fresh, k);
+    for (size_type i = 0; i < segment_size(k); ++i) {
+      ::new (static_cast<void*>(ready_flags + i)) std::atomic<bool>(false);
+    }
+    if (_segments[k].compare_exchange_strong(current, fresh,
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_acquire)) {
+      return fresh;
+    }
+    alloc_traits::deallocate(_alloc, fresh, allocation_size(k));
+    return current;
+  }
+
+  // Claims the next slot, then constructs the element, which must not
+  // throw, and marks the slot ready. The segments up to first_segment slots
+  // past the last claim are installed first, so that a failed allocation
+  // throws before anything is claimed.
+  template <typename... Args>
+  auto claim_and_construct(Args&&... args) -> reference {
+    size_type next = _claimed.load(std::memory_order_relaxed);
+    for (size_type k = segment_of(next);
+         k <= segment_of(next + first_segment) && k < _segment_count; ++k) {
+      segment(k);
+    }
+    size_type pos = _claimed.fetch_add(1, std::memory_order_relaxed);
+    size_type k = segment_of(pos);
+    pointer base = _segments[k].load(std::memory_order_acquire);
+    if (!base) [[unlikely]] {
+      base = claimed_segment(k);
+    }
+    pointer dest = base + pos - segment_start(k);
+    alloc_traits::construct(_alloc, dest, std::forward<Args>(args)...);
+    flags(base, k)[pos - segment_start(k)].store(true,
+                                                 std::memory_order_release);
+    return *dest;
+  }
+
+  // Segment k for a slot already claimed, when more than first_segment
+  // other pushes got in between the check above and the claim. Giving up
+  // would leave a hole that keeps every later element out of size(), so a
+  // failed allocation is retried until it, or another thread's, succeeds.
+  auto claimed_segment(size_type k) noexcept -> pointer {
+    while (true) {
+      try {
+        return segment(k);
+      } catch (...) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  template <bool Const>
+  class basic_iterator {
+    using owner =
+        std::conditional_t<Const, const concurrent_vec, concurrent_vec>;
+
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const T*, T*>;
+    using reference = std::conditional_t<Const, const T&, T&>;
+
+    basic_iterator() noexcept = default;
+
+    basic_iterator(owner* vec, size_type pos) noexcept
+        : _vec(vec), _pos(pos) {}
+
+    operator basic_iterator<true>() const noexcept
+      requires(!Const)
+    {
+      return basic_iterator<true>(_vec, _pos);
+    }
+
+    auto operator*() const noexcept -> reference {
+      return (*_vec)[_pos];
+    }
+
+    auto operator->() const noexcept -> pointer {
+      return &(*_vec)[_pos];
+    }
+
+    auto operator[](difference_type offset) const noexcept -> reference {
+      return (*_vec)[_pos + offset];
+    }
+
+    auto operator++() noexcept -> basic_iterator& {
+      ++_pos;
+      return *this;
+    }
+
+    auto operator++(int) noexcept -> basic_iterator {
+      return basic_iterator(_vec, _pos++);
+    }
+
+    auto operator--() noexcept -> basic_iterator& {
+      --_pos;
+      return *this;
+    }
+
+    auto operator--(int) noexcept -> basic_iterator {
+      return basic_iterator(_vec, _pos--);
+    }
+
+    auto operator+=(difference_type offset) noexcept -> basic_iterator& {
+      _pos += offset;
+      return *this;
+    }
+
+    auto operator-=(difference_type offset) noexcept -> basic_iterator& {
+      _pos -= offset;
+      return *this;
+    }
+
+    friend auto operator+(basic_iterator it, difference_type offset) noexcept
+        -> basic_iterator {
+      return it += offset;
+    }
+
+    friend auto operator+(difference_type offset, basic_iterator it) noexcept
+        -> basic_iterator {
+      return it += offset;
+    }
+
+    friend auto operator-(basic_iterator it, difference_type offset) noexcept
+        -> basic_iterator {
+      return it -= offset;
+    }
+
+    friend auto operator-(const basic_iterator& lhs,
+                          const basic_iterator& rhs) noexcept
+        -> difference_type {
+      return static_cast<difference_type>(lhs._pos) -
+             static_cast<difference_type>(rhs._pos);
+    }
+
+    friend auto operator==(const basic_iterator& lhs,
+                           const basic_iterator& rhs) noexcept -> bool {
+      return lhs._pos == rhs._pos;
+    }
+
+    friend auto operator<=>(const basic_iterator& lhs,
+                            const basic_iterator& rhs) noexcept {
+      return lhs._pos <=> rhs._pos;
+    }
+
+   private:
+    owner* _vec{nullptr};
+    size_type _pos{0};
+  };
+
+  [[no_unique_address]] allocator_type _alloc;
+  std::array<std::atomic<pointer>, _segment_count> _segments{};
+  // Writers hammer _claimed while readers poll _size; keep them on separate
+  // cache lines from each other and from the segment table. _size is a hint:
+  // a prefix of slots known to be ready, advanced by size().
+  alignas(cache_line_size) std::atomic<size_type> _claimed{0};
+  alignas(cache_line_size) mutable std::atomic<size_type> _size{0};
+};
+
+}  // namespace stl
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+#include "allocator.hpp"
+
+namespace stl {
+
+// A growth policy decides the capacity vec reallocates to when an append
+// finds it full. next_capacity receives the current capacity, the smallest
+// capacity the operation needs and the element size in bytes, and must return
+// a capacity of at least required.
+
+// Multiplies the capacity by Num / Den. The first allocation holds at least
+// MinBytes worth of elements (and always at least one element).
+template <std::size_t Num, std::size_t Den, std::size_t MinBytes = 0>
+struct geometric_growth {
+  static_assert(Num > Den, "geometric_growth: factor must exceed 1");
+
+  static constexpr auto next_capacity(std::size_t capacity,
+                                      std::size_t required,
+                                      std::size_t element_size) noexcept
+      -> std::size_t {
+    std::size_t grown = capacity + capacity / Den * (Num - Den) +
+                        capacity % Den * (Num - Den) / Den;
+    std::size_t floor = std::max<std::size_t>(
+        1, (MinBytes + element_size - 1) / element_size);
+    return std::max({required, grown, floor});
+  }
+};
+
+// Adds Step elements per reallocation.
+template <std::size_t Step>
+struct fixed_step_growth {
+  static_assert(Step > 0, "fixed_step_growth: step must be positive");
+
+  static constexpr auto next_capacity(std::size_t capacity,
+                                      std::size_t required,
+                                      std::size_t /*element_size*/) noexcept
+      -> std::size_t {
+    return std::max(required, capacity + Step);
+  }
+};
+
+// Applies Base, then rounds buffers of Threshold bytes or more up to a whole
+// number of PageSize pages so that no partially used page is ever mapped.
+template <typename Base,
+          std::size_t PageSize = 4096,
+          std::size_t Threshold = PageSize>
+struct page_rounded_growth {
+  static_assert((PageSize & (PageSize - 1)) == 0,
+                "page_rounded_growth: page size must be a power of two");
+
+  static constexpr auto next_capacity(std::size_t capacity,
+                                      std::size_t required,
+                                      std::size_t element_size) noexcept
+      -> std::size_t {
+    std::size_t next = Base::next_capacity(capacity, required, element_size);
+    std::size_t bytes = next * element_size;
+    if (bytes < Threshold) {
+      return next;
+    }
+    bytes = (bytes + PageSize - 1) & ~(PageSize - 1);
+    return bytes / element_size;
+  }
+};
+
+// The historical vec behaviour: 1, 2, 4, 8, ...
+using doubling_growth = geometric_growth<2, 1>;
+
+// 1.5x growth starting from a full cache line, which lets freed blocks be
+// reused by later reallocations and overshoots large sizes by at most 50%.
+using compact_growth = geometric_growth<3, 2, cache_line_size>;
+
+template <typename Base = compact_growth>
+using page_growth = page_rounded_growth<Base, 4096>;
+
+template <typename Base = compact_growth>
+using huge_page_growth =
+    page_rounded_growth<Base, huge_page_size, huge_page_size>;
+
+}  // namespace stl
@@ -0,0 +1,539 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <format>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "relocate.hpp"
+#include "simd.hpp"
+
+namespace stl {
+
+namespace detail {
+
+// Uninitialized inline element storage for inplace_vec: elements are only
+// constructed when they are pushed. Each copy and move operation is the
+// trivial one exactly when T's is, so that inplace_vec can default its own
+// under the same conditions and stay trivially copyable for trivially
+// copyable T.
+template <typename T, std::size_t N>
+struct inplace_storage {
+  constexpr inplace_storage() noexcept {}
+
+  constexpr inplace_storage(const inplace_storage&)
+    requires std::is_trivially_copy_constructible_v<T>
+  = default;
+
+  constexpr inplace_storage(const inplace_storage&) noexcept {}
+
+  constexpr inplace_storage(inplace_storage&&)
+    requires std::is_trivially_move_constructible_v<T>
+  = default;
+
+  constexpr inplace_storage(inplace_storage&&) noexcept {}
+
+  constexpr ~inplace_storage()
+    requires std::is_trivially_destructible_v<T>
+  = default;
+
+  constexpr ~inplace_storage() {}
+
+  constexpr auto operator=(const inplace_storage&) -> inplace_storage&
+    requires std::is_trivially_copy_assignable_v<T>
+  = default;
+
+  constexpr auto operator=(const inplace_storage&) noexcept
+      -> inplace_storage& {
+    return *this;
+  }
+
+  constexpr auto operator=(inplace_storage&&) -> inplace_storage&
+    requires std::is_trivially_move_assignable_v<T>
+  = default;
+
+  constexpr auto operator=(inplace_storage&&) noexcept -> inplace_storage& {
+    return *this;
+  }
+
+  constexpr auto data() noexcept -> T* {
+    return _elements;
+  }
+
+  constexpr auto data() const noexcept -> const T* {
+    return _elements;
+  }
+
+  union {
+    T _elements[N];
+  };
+};
+
+template <typename T>
+struct inplace_storage<T, 0> {
+  constexpr auto data() noexcept -> T* {
+    return nullptr;
+  }
+
+  constexpr auto data() const noexcept -> const T* {
+    return nullptr;
+  }
+};
+
+}  // namespace detail
+
+// Vector with a fixed capacity of N elements stored inline. It never
+// allocates, elements are only constructed when they are inserted, and T
+// need not be default constructible. Operations that would exceed N throw
+// std::length_error; the try_ variants return nullptr instead. Every member
+// is constexpr.
+template <typename T, std::size_t N>
+class inplace_vec {
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
+  using iterator = pointer;
+  using const_iterator = const_pointer;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  constexpr inplace_vec() noexcept = default;
+
+  constexpr explicit inplace_vec(size_type count) {
+    resize(count);
+  }
+
+  constexpr inplace_vec(size_type count, const T& value) {
+    resize(count, value);
+  }
+
+  template <typename InputIt>
+    requires std::input_iterator<InputIt>
+  constexpr inplace_vec(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  }
+
+  constexpr inplace_vec(std::initializer_list<T> init)
+      : inplace_vec(init.begin(), init.end()) {}
+
+  constexpr inplace_vec(const inplace_vec& other)
+    requires std::is_trivially_copy_constructible_v<T>
+  = default;
+
+  constexpr inplace_vec(const inplace_vec& other) {
+    construct_n(other.begin(), other._size, data());
+    _size = other._size;
+  }
+
+  constexpr inplace_vec(inplace_vec&& other)
+    requires std::is_trivially_move_constructible_v<T>
+  = default;
+
+  constexpr inplace_vec(inplace_vec&& other) noexcept(
+      std::is_nothrow_move_constructible_v<T>) {
+    construct_n(std::make_move_iterator(other.begin()), other._size, data());
+    _size = other._size;
+  }
+
+  constexpr ~inplace_vec()
+    requires std::is_trivially_destructible_v<T>
+  = default;
+
+  constexpr ~inplace_vec() {
+    clear();
+  }
+
+  constexpr auto operator=(const inplace_vec& other) -> inplace_vec&
+    requires std::is_trivially_copy_assignable_v<T> &&
+             std::is_trivially_copy_constructible_v<T> &&
+             std::is_trivially_destructible_v<T>
+  = default;
+
+  constexpr auto operator=(const inplace_vec& other) -> inplace_vec& {
+    if (this != &other) {
+      assign(other.begin(), other.end());
+    }
+    return *this;
+  }
+
+  constexpr auto operator=(inplace_vec&& other) -> inplace_vec&
+    requires std::is_trivially_move_assignable_v<T> &&
+             std::is_trivially_move_constructible_v<T> &&
+             std::is_trivially_destructible_v<T>
+  = default;
+
+  constexpr auto operator=(inplace_vec&& other) noexcept(
+      std::is_nothrow_move_constructible_v<T>) -> inplace_vec& {
+    if (this != &other) {
+      clear();
+      construct_n(std::make_move_iterator(other.begin()), other._size,
+                  data());
+      _size = other._size;
+    }
+    return *this;
+  }
+
+  constexpr auto operator=(std::initializer_list<T> init) -> inplace_vec& {
+    assign(init.begin(), init.end());
+    return *this;
+  }
+
+  constexpr auto assign(size_type count, const T& value) -> void {
+    require_room(count, "inplace_vec::assign");
+    clear();
+    resize(count, value);
+  }
+
+  template <typename InputIt>
+    requires std::input_iterator<InputIt>
+  constexpr auto assign(InputIt first, InputIt last) -> void {
+    clear();
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  }
+
+  constexpr auto at(size_type pos) -> reference {
+    if (pos >= _size) {
+      throw std::out_of_range(std::format(
+          "inplace_vec::at: position {} out of range {}", pos, _size));
+    }
+    return data()[pos];
+  }
+
+  constexpr auto at(size_type pos) const -> const_reference {
+    if (pos >= _size) {
+      throw std::out_of_range(std::format(
+          "inplace_vec::at: position {} out of range {}", pos, _size));
+    }
+    return data()[pos];
+  }
+
+  constexpr auto operator[](size_type pos) -> reference {
+    return data()[pos];
+  }
+
+  constexpr auto operator[](size_type pos) const -> const_reference {
+    return data()[pos];
+  }
+
+  constexpr auto front() -> reference {
+    return data()[0];
+  }
+
+  constexpr auto front() const -> const_reference {
+    return data()[0];
+  }
+
+  constexpr auto back() -> reference {
+    return data()[_size - 1];
+  }
+
+  constexpr auto back() const -> const_reference {
+    return data()[_size - 1];
+  }
+
+  constexpr auto data() noexcept -> pointer {
+    return _storage.data();
+  }
+
+  constexpr auto data() const noexcept -> const_pointer {
+    return _storage.data();
+  }
+
+  constexpr auto begin() noexcept -> iterator {
+    return data();
+  }
+
+  constexpr auto begin() const noexcept -> const_iterator {
+    return data();
+  }
+
+  constexpr auto end() noexcept -> iterator {
+    return data() + _size;
+  }
+
+  constexpr auto end() const noexcept -> const_iterator {
+    return data() + _size;
+  }
+
+  constexpr auto rbegin() noexcept -> reverse_iterator {
+    return reverse_iterator(end());
+  }
+
+  constexpr auto rbegin() const noexcept -> const_reverse_iterator {
+    return const_reverse_iterator(end());
+  }
+
+  constexpr auto rend() noexcept -> reverse_iterator {
+    return reverse_iterator(begin());
+  }
+
+  constexpr auto rend() const noexcept -> const_reverse_iterator {
+    return const_reverse_iterator(begin());
+  }
+
+  constexpr auto empty() const noexcept -> bool {
+    return _size == 0;
+  }
+
+  constexpr auto full() const noexcept -> bool {
+    return _size == N;
+  }
+
+  constexpr auto size() const noexcept -> size_type {
+    return _size;
+  }
+
+  static constexpr auto capacity() noexcept -> size_type {
+    return N;
+  }
+
+  static constexpr auto max_size() noexcept -> size_type {
+    return N;
+  }
+
+  constexpr auto clear() noexcept -> void {
+    std::destroy_n(data(), _size);
+    _size = 0;
+  }
+
+  constexpr auto push_back(const T& value) -> reference {
+    return emplace_back(value);
+  }
+
+  constexpr auto push_back(T&& value) -> reference {
+    return emplace_back(std::move(value));
+  }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  constexpr auto emplace_back(Args&&... args) -> reference {
+    require_room(_size + 1, "inplace_vec::emplace_back");
+    return unchecked_emplace_back(std::forward<Args>(args)...);
+  }
+
+  // Appends value if there is room. Returns a pointer to the new element,
+  // or nullptr (leaving the vector and value untouched) when full.
+  constexpr auto try_push_back(const T& value) -> pointer {
+    return try_emplace_back(value);
+  }
+
+  constexpr auto try_push_back(T&& value) -> pointer {
+    return try_emplace_back(std::move(value));
+  }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  constexpr auto try_emplace_back(Args&&... args) -> pointer {
+    if (_size == N) {
+      return nullptr;
+    }
+    return std::addressof(
+        unchecked_emplace_back(std::forward<Args>(args)...));
+  }
+
+  // Appends without checking capacity; the caller guarantees !full().
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  constexpr auto unchecked_emplace_back(Args&&... args) -> reference {
+    T* slot = std::construct_at(data() + _size, std::forward<Args>(args)...);
+    ++_size;
+    return *slot;
+  }
+
+  constexpr auto unchecked_push_back(const T& value) -> reference {
+    return unchecked_emplace_back(value);
+  }
+
+  constexpr auto unchecked_push_back(T&& value) -> reference {
+    return unchecked_emplace_back(std::move(value));
+  }
+
+  constexpr auto pop_back() -> void {
+    if (_size > 0) {
+      --_size;
+      std::destroy_at(data() + _size);
+    }
+  }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  constexpr auto emplace(const_iterator pos, Args&&... args) -> iterator {
+    size_type index = pos - begin();
+    require_room(_size + 1, "inplace_vec::emplace");
+    unchecked_emplace_back(std::forward<Args>(args)...);
+    std::rotate(begin() + index, end() - 1, end());
+    return begin() + index;
+  }
+
+  constexpr auto insert(const_iterator pos, const T& value) -> iterator {
+    return emplace(pos, value);
+  }
+
+  constexpr auto insert(const_iterator pos, T&& value) -> iterator {
+    return emplace(pos, std::move(value));
+  }
+
+  template <typename InputIt>
+    requires std::input_iterator<InputIt>
+  constexpr auto insert(const_iterator pos, InputIt first, InputIt last)
+      -> iterator {
+    size_type index = pos - begin();
+    size_type old_size = _size;
+    try {
+      for (; first != last; ++first) {
+        emplace_back(*first);
+      }
+    } catch (...) {
+      while (_size > old_size) {
+        pop_back();
+      }
+      throw;
+    }
+    std::rotate(begin() + index, begin() + old_size, end());
+    return begin() + index;
+  }
+
+  constexpr auto erase(const_iterator pos) -> iterator {
+    return erase(pos, pos + 1);
+  }
+
+  constexpr auto erase(const_iterator first, const_iterator last)
+      -> iterator {
+    iterator gap = begin() + (first - begin());
+    size_type count = last - first;
+    if (count != 0) {
+      iterator tail = std::move(gap + count, end(), gap);
+      std::destroy(tail, end());
+      _size -= count;
+    }
+    return gap;
+  }
+
+  // Erases pos in O(1) by moving the last element into its place. Does not
+  // preserve the order of the remaining elements.
+  constexpr auto swap_remove(const_iterator pos) -> iterator {
+    iterator hole = begin() + (pos - begin());
+    if (hole != end() - 1) {
+      *hole = std::move(back());
+    }
+    pop_back();
+    return hole;
+  }
+
+  constexpr auto resize(size_type count) -> void {
+    require_room(count, "inplace_vec::resize");
+    if (count > _size) {
+      for (size_type built = _size; built < count; ++built) {
+        unchecked_emplace_back();
+      }
+    } else {
+      std::destroy(data() + count, end());
+    }
+    _size = count;
+  }
+
+  constexpr auto resize(size_type count, const T& value) -> void {
+    require_room(count, "inplace_vec::resize");
+    if (count > _size) {
+      for (size_type built = _size; built < count; ++built) {
+        unchecked_emplace_back(value);
+      }
+    } else {
+      std::destroy(data() + count, end());
+    }
+    _size = count;
+  }
+
+  constexpr auto swap(inplace_vec& other) noexcept(
+      std::is_nothrow_move_constructible_v<T> &&
+      std::is_nothrow_swappable_v<T>) -> void {
+    inplace_vec& shorter = _size < other._size ? *this : other;
+    inplace_vec& longer = _size < other._size ? other : *this;
+    std::swap_ranges(shorter.begin(), shorter.end(), longer.begin());
+    construct_n(std::make_move_iterator(longer.begin() + shorter._size),
+                longer._size - shorter._size, shorter.end());
+    std::destroy(longer.begin() + shorter._size, longer.end());
+    std::swap(_size, other._size);
+  }
+
+  constexpr auto find(const T& value) -> iterator {
+    if constexpr (simd::vectorizable<T>) {
+      if (!std::is_constant_evaluated()) {
+        return begin() + simd::find(data(), _size, value);
+      }
+    }
+    return std::find(begin(), end(), value);
+  }
+
+  constexpr auto find(const T& value) const -> const_iterator {
+    return const_cast<inplace_vec&>(*this).find(value);
+  }
+
+  constexpr auto contains(const T& value) const -> bool {
+    return find(value) != end();
+  }
+
+  constexpr auto operator==(const inplace_vec& other) const -> bool {
+    return std::equal(begin(), end(), other.begin(), other.end());
+  }
+
+  constexpr auto operator<=>(const inplace_vec& other) const
+    requires std::three_way_comparable<T>
+  {
+    return std::lexicographical_compare_three_way(begin(), end(),
+                                                  other.begin(), other.end());
+  }
+
+ private:
+  static constexpr auto require_room(size_type count, const char* what)
+      -> void {
+    if (count > N) {
+      throw std::length_error(
+          std::format("{}: size {} exceeds capacity {}", what, count, N));
+    }
+  }
+
+  // Constructs count elements at dest from first, destroying the prefix
+  // already built if one throws. (The std::uninitialized_* algorithms are
+  // not constexpr before C++26.)
+  template <typename InputIt>
+  static constexpr auto construct_n(InputIt first, size_type count,
+                                    pointer dest) -> void {
+    size_type built = 0;
+    try {
+      for (; built < count; ++built, ++first) {
+        std::construct_at(dest + built, *first);
+      }
+    } catch (...) {
+      std::destroy_n(dest, built);
+      throw;
+    }
+  }
+
+  detail::inplace_storage<T, N> _storage;
+  size_type _size{0};
+};
+
+// inplace_vec owns no pointers into itself, so it relocates like its
+// elements do.
+template <typename T, std::size_t N>
+struct is_trivially_relocatable<inplace_vec<T, N>>
+    : is_trivially_relocatable<T> {};
+
+}  // namespace stl
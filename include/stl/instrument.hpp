@@ -0,0 +1,357 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <source_location>
+#include <string>
+#include <string_view>
+
+// Define STL_INSTRUMENT to 1 (the STL_INSTRUMENT CMake option does this) to
+// make vec, box and arc report allocation, reallocation and reference
+// counting events. It must have the same value in every translation unit.
+// With it at 0, the default, every hook is an empty inline function and
+// compiles away.
+#ifndef STL_INSTRUMENT
+#define STL_INSTRUMENT 0
+#endif
+
+namespace stl::instrument {
+
+inline constexpr bool enabled = STL_INSTRUMENT != 0;
+
+// Event counts for one container type or one call site. All fields are
+// updated with relaxed atomics and may be read while events are recorded.
+struct counters {
+  std::atomic<std::uint64_t> allocations{0};
+  std::atomic<std::uint64_t> deallocations{0};
+  std::atomic<std::uint64_t> bytes_allocated{0};
+  std::atomic<std::uint64_t> bytes_deallocated{0};
+  // vec storage moves, split by what triggered them.
+  std::atomic<std::uint64_t> growth_reallocations{0};
+  std::atomic<std::uint64_t> reserve_reallocations{0};
+  std::atomic<std::uint64_t> shrink_reallocations{0};
+  std::atomic<std::uint64_t> bytes_moved{0};
+  std::atomic<std::uint64_t> arc_blocks_created{0};
+  std::atomic<std::uint64_t> arc_blocks_destroyed{0};
+  // Highest strong count any arc control block has reached.
+  std::atomic<std::uint64_t> peak_refcount{0};
+  std::atomic<std::uint64_t> lock_successes{0};
+  std::atomic<std::uint64_t> lock_failures{0};
+
+  auto reset() noexcept -> void;
+};
+
+enum class reallocation { growth, reserve, shrink };
+
+namespace detail {
+
+struct entry {
+  bool is_site;
+  std::string name;
+  counters stats;
+};
+
+// Every counters object ever handed out. Entries are never removed, so
+// references to them stay valid for the life of the program.
+class registry {
+ public:
+  static auto instance() -> registry& {
+    static registry global;
+    return global;
+  }
+
+  auto find_or_add(bool is_site, std::string_view name) -> counters& {
+    std::lock_guard lock(_mutex);
+    for (auto& existing : _entries) {
+      if (existing.is_site == is_site && existing.name == name) {
+        return existing.stats;
+      }
+    }
+    return _entries.emplace_back(is_site, std::string(name)).stats;
+  }
+
+  template <typename Visitor>
+  auto for_each(Visitor visit) -> void {
+    std::lock_guard lock(_mutex);
+    for (auto& existing : _entries) {
+      visit(existing);
+    }
+  }
+
+ private:
+  std::mutex _mutex;
+  std::deque<entry> _entries;
+};
+
+// The spelling of T as reported by the compiler.
+template <typename T>
+constexpr auto type_name() noexcept -> std::string_view {
+  std::string_view name = __PRETTY_FUNCTION__;
+  std::size_t start = name.find("T = ") + 4;
+  std::size_t end = name.find(';', start);
+  if (end == std::string_view::npos) {
+    end = name.rfind(']');
+  }
+  return name.substr(start, end - start);
+}
+
+inline thread_local counters* current_site = nullptr;
+
+inline auto add(std::atomic<std::uint64_t>& counter,
+                std::uint64_t amount = 1) noexcept -> void {
+  counter.fetch_add(amount, std::memory_order_relaxed);
+}
+
+inline auto raise(std::atomic<std::uint64_t>& counter,
+                  std::uint64_t value) noexcept -> void {
+  std::uint64_t seen = counter.load(std::memory_order_relaxed);
+  while (seen < value && !counter.compare_exchange_weak(
+                             seen, value, std::memory_order_relaxed)) {
+  }
+}
+
+// Applies record to the counters of Type and of the active site, if any.
+template <typename Type, typename Record>
+inline auto record(Record update) noexcept -> void {
+  static counters& stats = registry::instance().find_or_add(
+      false, type_name<Type>());
+  update(stats);
+  if (current_site) {
+    update(*current_site);
+  }
+}
+
+}  // namespace detail
+
+inline auto counters::reset() noexcept -> void {
+  for (auto* counter :
+       {&allocations, &deallocations, &bytes_allocated, &bytes_deallocated,
+        &growth_reallocations, &reserve_reallocations, &shrink_reallocations,
+        &bytes_moved, &arc_blocks_created, &arc_blocks_destroyed,
+        &peak_refcount, &lock_successes, &lock_failures}) {
+    counter->store(0, std::memory_order_relaxed);
+  }
+}
+
+// The counters for events raised by containers of type Type, e.g.
+// stl::vec<int>.
+template <typename Type>
+auto counters_for() -> counters& {
+  return detail::registry::instance().find_or_add(false,
+                                                  detail::type_name<Type>());
+}
+
+// The counters for the call site called name.
+inline auto site_counters(std::string_view name) -> counters& {
+  return detail::registry::instance().find_or_add(true, name);
+}
+
+// "file:line function", the name STL_INSTRUMENT_SITE gives a site.
+inline auto site_name(const std::source_location& location) -> std::string {
+  return std::string(location.file_name()) + ':' +
+         std::to_string(location.line()) + ' ' + location.function_name();
+}
+
+// While a site is alive, events raised on its thread are also counted
+// against it. Sites nest; the innermost one wins.
+class site {
+ public:
+  explicit site(counters& stats) noexcept
+      : _previous(detail::current_site) {
+    detail::current_site = &stats;
+  }
+
+  explicit site(std::string_view name) : site(site_counters(name)) {}
+
+  site(const site&) = delete;
+
+  ~site() {
+    detail::current_site = _previous;
+  }
+
+  auto operator=(const site&) -> site& = delete;
+
+ private:
+  counters* _previous;
+};
+
+// Zeroes every counter.
+inline auto reset() -> void {
+  detail::registry::instance().for_each(
+      [](detail::entry& existing) { existing.stats.reset(); });
+}
+
+namespace detail {
+
+inline auto append_escaped(std::string& out, std::string_view text) -> void {
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+    }
+    out += c == '\n' ? ' ' : c;
+  }
+}
+
+template <typename Visitor>
+auto for_each_field(const counters& stats, Visitor visit) -> void {
+  visit("allocations", stats.allocations);
+  visit("deallocations", stats.deallocations);
+  visit("bytes_allocated", stats.bytes_allocated);
+  visit("bytes_deallocated", stats.bytes_deallocated);
+  visit("growth_reallocations", stats.growth_reallocations);
+  visit("reserve_reallocations", stats.reserve_reallocations);
+  visit("shrink_reallocations", stats.shrink_reallocations);
+  visit("bytes_moved", stats.bytes_moved);
+  visit("arc_blocks_created", stats.arc_blocks_created);
+  visit("arc_blocks_destroyed", stats.arc_blocks_destroyed);
+  visit("peak_refcount", stats.peak_refcount);
+  visit("lock_successes", stats.lock_successes);
+  visit("lock_failures", stats.lock_failures);
+}
+
+}  // namespace detail
+
+// {"types": [{"name": ..., "allocations": ..., ...}, ...], "sites": [...]}
+inline auto dump_json() -> std::string {
+  std::string types;
+  std::string sites;
+  detail::registry::instance().for_each([&](detail::entry& existing) {
+    std::string& out = existing.is_site ? sites : types;
+    out += out.empty() ? "\n    {\"name\": \"" : ",\n    {\"name\": \"";
+    detail::append_escaped(out, existing.name);
+    out += '"';
+    detail::for_each_field(existing.stats, [&](const char* field,
+                                               const auto& counter) {
+      out += std::string(", \"") + field + "\": " +
+             std::to_string(counter.load(std::memory_order_relaxed));
+    });
+    out += '}';
+  });
+  return "{\n  \"types\": [" + types + (types.empty() ? "" : "\n  ") +
+         "],\n  \"sites\": [" + sites + (sites.empty() ? "" : "\n  ") +
+         "]\n}\n";
+}
+
+// Prometheus text exposition format: one stl_<field> metric family per
+// counter, labelled with type="..." or site="...".
+inline auto dump_prometheus() -> std::string {
+  std::string out;
+  counters names;
+  detail::for_each_field(names, [&](const char* field, const auto&) {
+    std::string_view name = field;
+    bool gauge = name == "peak_refcount";
+    std::string metric =
+        std::string("stl_") + field + (gauge ? "" : "_total");
+    out += "# TYPE " + metric + (gauge ? " gauge\n" : " counter\n");
+    detail::registry::instance().for_each([&](detail::entry& existing) {
+      out += metric + (existing.is_site ? "{site=\"" : "{type=\"");
+      detail::append_escaped(out, existing.name);
+      out += "\"} ";
+      detail::for_each_field(existing.stats, [&](const char* other,
+                                                 const auto& counter) {
+        if (std::string_view(other) == name) {
+          out += std::to_string(counter.load(std::memory_order_relaxed));
+        }
+      });
+      out += '\n';
+    });
+  });
+  return out;
+}
+
+// Hooks called by the containers. Each is empty unless instrumentation is
+// enabled.
+
+template <typename Type>
+inline auto on_allocate([[maybe_unused]] std::size_t bytes) noexcept -> void {
+  if constexpr (enabled) {
+    detail::record<Type>([&](counters& stats) {
+      detail::add(stats.allocations);
+      detail::add(stats.bytes_allocated, bytes);
+    });
+  }
+}
+
+template <typename Type>
+inline auto on_deallocate([[maybe_unused]] std::size_t bytes) noexcept
+    -> void {
+  if constexpr (enabled) {
+    detail::record<Type>([&](counters& stats) {
+      detail::add(stats.deallocations);
+      detail::add(stats.bytes_deallocated, bytes);
+    });
+  }
+}
+
+template <typename Type>
+inline auto on_reallocate([[maybe_unused]] reallocation reason,
+                          [[maybe_unused]] std::size_t bytes_moved) noexcept
+    -> void {
+  if constexpr (enabled) {
+    detail::record<Type>([&](counters& stats) {
+      detail::add(reason == reallocation::growth ? stats.growth_reallocations
+                  : reason == reallocation::reserve
+                      ? stats.reserve_reallocations
+                      : stats.shrink_reallocations);
+      detail::add(stats.bytes_moved, bytes_moved);
+    });
+  }
+}
+
+template <typename Type>
+inline auto on_arc_create() noexcept -> void {
+  if constexpr (enabled) {
+    detail::record<Type>(
+        [](counters& stats) { detail::add(stats.arc_blocks_created); });
+  }
+}
+
+template <typename Type>
+inline auto on_arc_destroy() noexcept -> void {
+  if constexpr (enabled) {
+    detail::record<Type>(
+        [](counters& stats) { detail::add(stats.arc_blocks_destroyed); });
+  }
+}
+
+// Called with the strong count an arc reached after an increment.
+template <typename Type>
+inline auto on_ref([[maybe_unused]] std::size_t count) noexcept -> void {
+  if constexpr (enabled) {
+    detail::record<Type>(
+        [&](counters& stats) { detail::raise(stats.peak_refcount, count); });
+  }
+}
+
+template <typename Type>
+inline auto on_lock([[maybe_unused]] bool success) noexcept -> void {
+  if constexpr (enabled) {
+    detail::record<Type>([&](counters& stats) {
+      detail::add(success ? stats.lock_successes : stats.lock_failures);
+    });
+  }
+}
+
+}  // namespace stl::instrument
+
+#define STL_INSTRUMENT_CONCAT_IMPL(a, b) a##b
+#define STL_INSTRUMENT_CONCAT(a, b) STL_INSTRUMENT_CONCAT_IMPL(a, b)
+
+// Attributes the enclosing scope's events to a site named after this
+// source line (file:line function). The counters are looked up once, and
+// the whole statement disappears when instrumentation is disabled.
+#if STL_INSTRUMENT
+#define STL_INSTRUMENT_SITE()                                               \
+  static ::stl::instrument::counters& STL_INSTRUMENT_CONCAT(               \
+      stl_instrument_counters_, __LINE__) =                                \
+      ::stl::instrument::site_counters(::stl::instrument::site_name(       \
+          std::source_location::current()));                               \
+  ::stl::instrument::site STL_INSTRUMENT_CONCAT(stl_instrument_site_,      \
+                                                __LINE__)(                 \
+      STL_INSTRUMENT_CONCAT(stl_instrument_counters_, __LINE__))
+#else
+#define STL_INSTRUMENT_SITE() static_assert(true)
+#endif
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <utility>
+
+#include "relocate.hpp"
+
+namespace stl {
+
+template <typename T>
+class intrusive_arc;
+
+// CRTP base that embeds an atomic reference count in T, so that
+// intrusive_arc<T> needs no control block and can be built from any T*,
+// including this. Copying or assigning a T leaves its count alone.
+template <typename T>
+class intrusive_ref_counted {
+ public:
+  auto use_count() const noexcept -> std::size_t {
+    return _ref_count.load(std::memory_order_relaxed);
+  }
+
+ protected:
+  intrusive_ref_counted() noexcept = default;
+
+  intrusive_ref_counted(const intrusive_ref_counted&) noexcept {}
+
+  ~intrusive_ref_counted() = default;
+
+  auto operator=(const intrusive_ref_counted&) noexcept
+      -> intrusive_ref_counted& {
+    return *this;
+  }
+
+ private:
+  template <typename>
+  friend class intrusive_arc;
+
+  auto add_ref() const noexcept -> void {
+    _ref_count.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Returns whether that was the last reference.
+  auto release_ref() const noexcept -> bool {
+    return _ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+
+  mutable std::atomic<std::size_t> _ref_count{0};
+};
+
+// A one-pointer arc for types deriving from intrusive_ref_counted. The
+// object must have been allocated with new; it is deleted through T*, so
+// polymorphic hierarchies need a virtual destructor.
+template <typename T>
+class intrusive_arc {
+ public:
+  using element_type = T;
+
+  intrusive_arc() noexcept : _object(nullptr) {}
+
+  // Takes a new reference to *ptr.
+  explicit intrusive_arc(T* ptr) noexcept : _object(ptr) {
+    if (_object) {
+      _object->add_ref();
+    }
+  }
+
+  intrusive_arc(const intrusive_arc& other) noexcept
+      : intrusive_arc(other._object) {}
+
+  template <typename U>
+    requires std::convertible_to<U*, T*>
+  intrusive_arc(const intrusive_arc<U>& other) noexcept
+      : intrusive_arc(other._object) {}
+
+  intrusive_arc(intrusive_arc&& other) noexcept
+      : _object(std::exchange(other._object, nullptr)) {}
+
+  template <typename U>
+    requires std::convertible_to<U*, T*>
+  intrusive_arc(intrusive_arc<U>&& other) noexcept
+      : _object(std::exchange(other._object, nullptr)) {}
+
+  ~intrusive_arc() {
+    reset();
+  }
+
+  auto reset(T* ptr = nullptr) noexcept -> void {
+    if (ptr) {
+      ptr->add_ref();
+    }
+    T* old = std::exchange(_object, ptr);
+    if (old && old->release_ref()) {
+      delete old;
+    }
+  }
+
+  auto use_count() const noexcept -> std::size_t {
+    return _object ? _object->use_count() : 0;
+  }
+
+  auto get() const noexcept -> T* {
+    return _object;
+  }
+
+  explicit operator bool() const noexcept {
+    return _object != nullptr;
+  }
+
+  auto operator*() const -> T& {
+    return *_object;
+  }
+
+  auto operator->() const noexcept -> T* {
+    return _object;
+  }
+
+  auto operator=(const intrusive_arc& other) noexcept -> intrusive_arc& {
+    reset(other._object);
+    return *this;
+  }
+
+  auto operator=(intrusive_arc&& other) noexcept -> intrusive_arc& {
+    if (this != &other) {
+      reset();
+      _object = std::exchange(other._object, nullptr);
+    }
+    return *this;
+  }
+
+  auto operator==(const intrusive_arc& other) const noexcept -> bool {
+    return _object == other._object;
+  }
+
+  auto operator<=>(const intrusive_arc& other) const noexcept
+      -> std::strong_ordering {
+    return _object <=> other._object;
+  }
+
+ private:
+  template <typename>
+  friend class intrusive_arc;
+
+  T* _object;
+};
+
+template <typename T>
+struct is_trivially_relocatable<intrusive_arc<T>> : std::true_type {};
+
+template <typename T, typename... Args>
+auto make_intrusive_arc(Args&&... args) -> intrusive_arc<T> {
+  return intrusive_arc<T>(new T(std::forward<Args>(args)...));
+}
+
+}  // namespace stl
@@ -0,0 +1,394 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <concepts>
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "growth.hpp"
+
+namespace stl {
+
+enum class mmap_mode {
+  // Private copy-on-write mapping; the file is never written. Members that
+  // change the size throw std::logic_error, while writes through element
+  // accessors are allowed but stay in this process's copy of the pages.
+  read_only,
+  // Shared writable mapping; changes reach the file and other processes.
+  read_write,
+};
+
+// A vec whose elements live in a memory-mapped file. The file holds exactly
+// size() elements once the mmap_vec is closed; while it is open the file is
+// extended to capacity() elements so that appends land in mapped pages.
+// Growth extends the file with ftruncate and the mapping with mremap, so no
+// element is ever copied through user space.
+template <typename T, typename Growth = page_growth<>>
+  requires std::is_trivially_copyable_v<T>
+class mmap_vec {
+ public:
+  using value_type = T;
+  using growth_policy = Growth;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
+  using iterator = pointer;
+  using const_iterator = const_pointer;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  mmap_vec() noexcept = default;
+
+  // Maps an existing file whose length is a whole number of elements.
+  static auto open(const std::filesystem::path& path,
+                   mmap_mode mode = mmap_mode::read_write) -> mmap_vec {
+    int flags = mode == mmap_mode::read_only ? O_RDONLY : O_RDWR;
+    mmap_vec result(checked(::open(path.c_str(), flags | O_CLOEXEC),
+                            "mmap_vec::open"),
+                    mode);
+    struct stat info {};
+    checked(::fstat(result._fd, &info), "mmap_vec::open");
+    auto bytes = static_cast<size_type>(info.st_size);
+    if (bytes % sizeof(T) != 0) {
+      throw std::runtime_error(std::format(
+          "mmap_vec::open: file size {} is not a multiple of element size {}",
+          bytes, sizeof(T)));
+    }
+    result._size = bytes / sizeof(T);
+    result.map(result._size);
+    return result;
+  }
+
+  // Creates (or truncates) path and maps it with room for capacity elements.
+  static auto create(const std::filesystem::path& path, size_type capacity = 0)
+      -> mmap_vec {
+    mmap_vec result(
+        checked(::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                       0644),
+                "mmap_vec::create"),
+        mmap_mode::read_write);
+    result.reserve(capacity);
+    return result;
+  }
+
+  mmap_vec(const mmap_vec&) = delete;
+
+  mmap_vec(mmap_vec&& other) noexcept
+      : _fd(std::exchange(other._fd, -1)),
+        _mode(other._mode),
+        _size(std::exchange(other._size, 0)),
+        _capacity(std::exchange(other._capacity, 0)),
+        _buffer(std::exchange(other._buffer, nullptr)) {}
+
+  ~mmap_vec() {
+    close();
+  }
+
+  auto operator=(const mmap_vec&) -> mmap_vec& = delete;
+
+  auto operator=(mmap_vec&& other) noexcept -> mmap_vec& {
+    if (this != &other) {
+      close();
+      _fd = std::exchange(other._fd, -1);
+      _mode = other._mode;
+      _size = std::exchange(other._size, 0);
+      _capacity = std::exchange(other._capacity, 0);
+      _buffer = std::exchange(other._buffer, nullptr);
+    }
+    return *this;
+  }
+
+  // Unmaps the file and trims it to size() elements. Safe to call twice.
+  auto close() noexcept -> void {
+    if (_buffer) {
+      ::munmap(_buffer, _capacity * sizeof(T));
+    }
+    if (_fd >= 0) {
+      if (_mode == mmap_mode::read_write) {
+        static_cast<void>(
+            ::ftruncate(_fd, static_cast<off_t>(_size * sizeof(T))));
+      }
+      ::close(_fd);
+    }
+    _fd = -1;
+    _size = 0;
+    _capacity = 0;
+    _buffer = nullptr;
+  }
+
+  // Writes dirty pages back to the file. With sync = false the write-back is
+  // only scheduled (MS_ASYNC).
+  auto flush(bool sync = true) -> void {
+    if (_buffer && _mode == mmap_mode::read_write) {
+      checked(::msync(_buffer, _capacity * sizeof(T),
+                      sync ? MS_SYNC : MS_ASYNC),
+              "mmap_vec::flush");
+    }
+  }
+
+  auto is_open() const noexcept -> bool {
+    return _fd >= 0;
+  }
+
+  auto mode() const noexcept -> mmap_mode {
+    return _mode;
+  }
+
+  auto at(size_type pos) -> reference {
+    if (pos >= _size) {
+      throw std::out_of_range(
+          std::format("mmap_vec::at: position {} out of range {}", pos, _size));
+    }
+    return _buffer[pos];
+  }
+
+  auto at(size_type pos) const -> const_reference {
+    if (pos >= _size) {
+      throw std::out_of_range(
+          std::format("mmap_vec::at: position {} out of range {}", pos, _size));
+    }
+    return _buffer[pos];
+  }
+
+  auto operator[](size_type pos) -> reference {
+    return _buffer[pos];
+  }
+
+  auto operator[](size_type pos) const -> const_reference {
+    return _buffer[pos];
+  }
+
+  auto front() -> reference {
+    return _buffer[0];
+  }
+
+  auto front() const -> const_reference {
+    return _buffer[0];
+  }
+
+  auto back() -> reference {
+    return _buffer[_size - 1];
+  }
+
+  auto back() const -> const_reference {
+    return _buffer[_size - 1];
+  }
+
+  auto data() noexcept -> pointer {
+    return _buffer;
+  }
+
+  auto data() const noexcept -> const_pointer {
+    return _buffer;
+  }
+
+  auto begin() noexcept -> iterator {
+    return _buffer;
+  }
+
+  auto begin() const noexcept -> const_iterator {
+    return _buffer;
+  }
+
+  auto end() noexcept -> iterator {
+    return _buffer + _size;
+  }
+
+  auto end() const noexcept -> const_iterator {
+    return _buffer + _size;
+  }
+
+  auto rbegin() noexcept -> reverse_iterator {
+    return reverse_iterator(end());
+  }
+
+  auto rbegin() const noexcept -> const_reverse_iterator {
+    return const_reverse_iterator(end());
+  }
+
+  auto rend() noexcept -> reverse_iterator {
+    return reverse_iterator(begin());
+  }
+
+  auto rend() const noexcept -> const_reverse_iterator {
+    return const_reverse_iterator(begin());
+  }
+
+  auto empty() const noexcept -> bool {
+    return _size == 0;
+  }
+
+  auto size() const noexcept -> size_type {
+    return _size;
+  }
+
+  auto capacity() const noexcept -> size_type {
+    return _capacity;
+  }
+
+  auto reserve(size_type new_cap) -> void {
+    if (new_cap > _capacity) {
+      remap(new_cap);
+    }
+  }
+
+  auto shrink_to_fit() -> void {
+    if (_size < _capacity) {
+      remap(_size);
+    }
+  }
+
+  auto clear() -> void {
+    require_writable("mmap_vec::clear");
+    _size = 0;
+  }
+
+  auto push_back(const T& value) -> void {
+    emplace_back(value);
+  }
+
+  template <typename... Args>
+  auto emplace_back(Args&&... args) -> reference
+    requires std::constructible_from<T, Args...>
+  {
+    require_writable("mmap_vec::emplace_back");
+    if (_size == _capacity) [[unlikely]] {
+      // args may refer into the mapping, which growing may move; build the
+      // element first.
+      T value(std::forward<Args>(args)...);
+      reserve(Growth::next_capacity(_capacity, _size + 1, sizeof(T)));
+      new (_buffer + _size) T(value);
+    } else {
+      new (_buffer + _size) T(std::forward<Args>(args)...);
+    }
+    ++_size;
+    return back();
+  }
+
+  auto pop_back() -> void {
+    require_writable("mmap_vec::pop_back");
+    if (_size > 0) {
+      --_size;
+    }
+  }
+
+  auto resize(size_type count) -> void {
+    resize(count, T());
+  }
+
+  auto resize(size_type count, const T& value) -> void {
+    require_writable("mmap_vec::resize");
+    if (count > _size) {
+      // value may be an element, which growing may move.
+      T fill = value;
+      reserve(count);
+      std::uninitialized_fill_n(_buffer + _size, count - _size, fill);
+    }
+    _size = count;
+  }
+
+  auto swap(mmap_vec& other) noexcept -> void {
+    std::swap(_fd, other._fd);
+    std::swap(_mode, other._mode);
+    std::swap(_size, other._size);
+    std::swap(_capacity, other._capacity);
+    std::swap(_buffer, other._buffer);
+  }
+
+ private:
+  mmap_vec(int fd, mmap_mode mode) noexcept : _fd(fd), _mode(mode) {}
+
+  static auto checked(int result, const char* what) -> int {
+    if (result < 0) {
+      throw std::system_error(errno, std::generic_category(), what);
+    }
+    return result;
+  }
+
+  auto require_writable(const char* what) const -> void {
+    if (_mode != mmap_mode::read_write) {
+      throw std::logic_error(std::format("{}: mapping is read-only", what));
+    }
+  }
+
+  // Read-only files are mapped writable but private, so that the
+  // non-const accessors are as safe to use as in read_write mode.
+  auto sharing() const noexcept -> int {
+    return _mode == mmap_mode::read_only ? MAP_PRIVATE : MAP_SHARED;
+  }
+
+  // Maps the first count elements of the file into a fresh mapping.
+  auto map(size_type count) -> void {
+    if (count != 0) {
+      void* mapped = ::mmap(nullptr, count * sizeof(T), PROT_READ | PROT_WRITE,
+                            sharing(), _fd, 0);
+      if (mapped == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(),
+                                "mmap_vec::map");
+      }
+      _buffer = static_cast<pointer>(mapped);
+    }
+    _capacity = count;
+  }
+
+  // Resizes the file to new_cap elements and grows or shrinks the mapping to
+  // match, keeping the first size() elements in place.
+  auto remap(size_type new_cap) -> void {
+    require_writable("mmap_vec::reserve");
+    size_type old_cap = _capacity;
+    if (new_cap > old_cap) {
+      checked(::ftruncate(_fd, static_cast<off_t>(new_cap * sizeof(T))),
+              "mmap_vec::reserve");
+    }
+    if (!_buffer || new_cap == 0) {
+      if (_buffer) {
+        ::munmap(_buffer, _capacity * sizeof(T));
+        _buffer = nullptr;
+      }
+      map(new_cap);
+    } else {
+#if defined(__linux__)
+      void* moved = ::mremap(_buffer, _capacity * sizeof(T),
+                             new_cap * sizeof(T), MREMAP_MAYMOVE);
+      if (moved == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(),
+                                "mmap_vec::reserve");
+      }
+      _buffer = static_cast<pointer>(moved);
+      _capacity = new_cap;
+#else
+      ::munmap(_buffer, _capacity * sizeof(T));
+      _buffer = nullptr;
+      map(new_cap);
+#endif
+    }
+    if (new_cap < old_cap) {
+      checked(::ftruncate(_fd, static_cast<off_t>(new_cap * sizeof(T))),
+              "mmap_vec::shrink_to_fit");
+    }
+  }
+
+  int _fd{-1};
+  mmap_mode _mode{mmap_mode::read_write};
+  size_type _size{0};
+  size_type _capacity{0};
+  pointer _buffer{nullptr};
+};
+
+}  // namespace stl
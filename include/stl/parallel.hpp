@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <format>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+// Parallel algorithms over contiguous ranges such as vec and arr. Each one
+// splits its range into contiguous blocks with thread_pool::parallel_for, so
+// the calling thread always works on the first block and the same range is
+// handed out to the same threads call after call. Ranges smaller than a few
+// grains run serially on the caller.
+namespace stl::parallel {
+
+// Smallest block worth handing to another thread, in elements of T.
+template <typename T>
+inline constexpr std::size_t grain = std::max<std::size_t>(
+    1, (std::size_t{32} << 10) / sizeof(T));
+
+namespace detail {
+
+template <typename R>
+using element_t = std::remove_reference_t<std::ranges::range_reference_t<R>>;
+
+template <typename In, typename Out>
+auto require_fits(const In& in, const Out& out, const char* what) -> void {
+  if (std::ranges::size(out) < std::ranges::size(in)) {
+    throw std::length_error(
+        std::format("{}: output size {} is smaller than input size {}", what,
+                    std::ranges::size(out), std::ranges::size(in)));
+  }
+}
+
+// Number of blocks parallel_for would use for count elements, for
+// algorithms that need to know the block boundaries themselves.
+inline auto block_count(thread_pool& pool, std::size_t count,
+                        std::size_t min_block) noexcept -> std::size_t {
+  return std::max<std::size_t>(
+      1, std::min(pool.concurrency(), count / std::max<std::size_t>(
+                                                  min_block, 1)));
+}
+
+}  // namespace detail
+
+// Calls f on every element.
+template <std::ranges::contiguous_range R, typename F>
+  requires std::ranges::sized_range<R>
+auto for_each(R&& range, F f, thread_pool& pool = thread_pool::global())
+    -> void {
+  auto* data = std::ranges::data(range);
+  pool.parallel_for(0, std::ranges::size(range),
+                    grain<detail::element_t<R>>,
+                    [data, &f](std::size_t begin, std::size_t end) {
+                      std::for_each(data + begin, data + end, f);
+                    });
+}
+
+// Writes f(in[i]) to out[i]. Throws std::length_error if out is shorter than
+// in.
+template <std::ranges::contiguous_range In,
+          std::ranges::contiguous_range Out,
+          typename F>
+  requires std::ranges::sized_range<In> && std::ranges::sized_range<Out>
+auto transform(const In& in,
+               Out&& out,
+               F f,
+               thread_pool& pool = thread_pool::global()) -> void {
+  detail::require_fits(in, out, "parallel::transform");
+  auto* source = std::ranges::data(in);
+  auto* dest = std::ranges::data(out);
+  pool.parallel_for(0, std::ranges::size(in), grain<detail::element_t<In>>,
+                    [source, dest, &f](std::size_t begin, std::size_t end) {
+                      std::transform(source + begin, source + end,
+                                     dest + begin, f);
+                    });
+}
+
+// Folds the range into init with op, which must be associative. Blocks are
+// reduced in parallel and their results combined left to right.
+template <std::ranges::contiguous_range R,
+          typename T,
+          typename BinaryOp = std::plus<>>
+  requires std::ranges::sized_range<R>
+auto reduce(const R& range,
+            T init,
+            BinaryOp op = {},
+            thread_pool& pool = thread_pool::global()) -> T {
+  auto* data = std::ranges::data(range);
+  std::size_t count = std::ranges::size(range);
+  std::size_t blocks =
+      detail::block_count(pool, count, grain<detail::element_t<R>>);
+
+  std::vector<std::optional<T>> partials(blocks);
+  pool.parallel_for(0, blocks, 1, [&](std::size_t first, std::size_t last) {
+    for (std::size_t block = first; block < last; ++block) {
+      const auto* it = data + count * block / blocks;
+      const auto* end = data + count * (block + 1) / blocks;
+      if (it != end) {
+        T acc = *it;
+        while (++it != end) {
+          acc = op(std::move(acc), *it);
+        }
+        partials[block].emplace(std::move(acc));
+      }
+    }
+  });
+
+  for (auto& partial : partials) {
+    if (partial) {
+      init = op(std::move(init), std::move(*partial));
+    }
+  }
+  return init;
+}
+
+// Assigns value to every element.
+template <std::ranges::contiguous_range R, typename T>
+  requires std::ranges::sized_range<R>
+auto fill(R&& range, const T& value, thread_pool& pool = thread_pool::global())
+    -> void {
+  using element = detail::element_t<R>;
+  auto* data = std::ranges::data(range);
+  pool.parallel_for(0, std::ranges::size(range), grain<element>,
+                    [data, &value](std::size_t begin, std::size_t end) {
+                      if constexpr (simd::vectorizable<element> &&
+                                    std::is_same_v<element, T>) {
+                        simd::fill(data + begin, end - begin, value);
+                      } else {
+                        std::fill(data + begin, data + end, value);
+                      }
+                    });
+}
+
+// Copies in to the front of out. Throws std::length_error if out is shorter
+// than in.
+template <std::ranges::contiguous_range In, std::ranges::contiguous_range Out>
+  requires std::ranges::sized_range<In> && std::ranges::sized_range<Out>
+auto copy(const In& in, Out&& out, thread_pool& pool = thread_pool::global())
+    -> void {
+  detail::require_fits(in, out, "parallel::copy");
+  auto* source = std::ranges::data(in);
+  auto* dest = std::ranges::data(out);
+  pool.parallel_for(0, std::ranges::size(in), grain<detail::element_t<In>>,
+                    [source, dest](std::size_t begin, std::size_t end) {
+                      std::copy(source + begin, source + end, dest + begin);
+                    });
+}
+
+// Sorts the range (not stably). Each block is sorted on its own thread, then
+// neighbouring runs are merged pairwise, halving the run count per round.
+template <std::ranges::contiguous_range R, typename Compare = std::less<>>
+  requires std::ranges::sized_range<R>
+auto sort(R&& range,
+          Compare comp = {},
+          thread_pool& pool = thread_pool::global()) -> void {
+  auto* data = std::ranges::data(range);
+  std::size_t count = std::ranges::size(range);
+  // Merging costs a pass over the data per round, so blocks are kept larger
+  // than for the linear algorithms.
+  std::size_t blocks =
+      detail::block_count(pool, count, 8 * grain<detail::element_t<R>>);
+  auto bound = [count, blocks](std::size_t block) {
+    return count * std::min(block, blocks) / blocks;
+  };
+
+  pool.parallel_for(0, blocks, 1, [&](std::size_t first, std::size_t last) {
+    for (std::size_t block = first; block < last; ++block) {
+      std::sort(data + bound(block), data + bound(block + 1), comp);
+    }
+  });
+
+  for (std::size_t width = 1; width < blocks; width *= 2) {
+    std::size_t pairs = (blocks + 2 * width - 1) / (2 * width);
+    pool.parallel_for(0, pairs, 1, [&](std::size_t first, std::size_t last) {
+      for (std::size_t pair = first; pair < last; ++pair) {
+        std::size_t low = pair * 2 * width;
+        std::inplace_merge(data + bound(low), data + bound(low + width),
+                           data + bound(low + 2 * width), comp);
+      }
+    });
+  }
+}
+
+}  // namespace stl::parallel
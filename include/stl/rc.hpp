@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "arc.hpp"
+
+namespace stl {
+
+// Single-threaded counterparts of arc and weak_arc, with the same interface,
+// aliasing constructor included. The counts are plain integers, so copies
+// and destruction cost no atomic instructions, and neither an rc nor its
+// weak_rcs may be shared between threads.
+template <typename T>
+using rc = basic_arc<T, plain_count>;
+
+template <typename T>
+using weak_rc = basic_weak_arc<T, plain_count>;
+
+template <typename T, typename... Args>
+auto make_rc(Args&&... args) -> rc<T>
+  requires(!std::is_unbounded_array_v<T>)
+{
+  return rc<T>(std::in_place, std::forward<Args>(args)...);
+}
+
+// make_rc, with the object and its counts allocated through alloc.
+template <typename T, typename Allocator, typename... Args>
+auto allocate_rc(const Allocator& alloc, Args&&... args) -> rc<T>
+  requires(!std::is_array_v<T>)
+{
+  return rc<T>(std::allocator_arg, alloc, std::forward<Args>(args)...);
+}
+
+template <typename T>
+auto make_rc(std::size_t n) -> rc<T>
+  requires std::is_unbounded_array_v<T>
+{
+  return rc<T>(n);
+}
+
+template <typename T>
+auto make_rc(std::size_t n, const std::remove_extent_t<T>& value) -> rc<T>
+  requires std::is_unbounded_array_v<T>
+{
+  return rc<T>(n, value);
+}
+
+template <typename T>
+auto make_rc_for_overwrite(std::size_t n) -> rc<T>
+  requires std::is_unbounded_array_v<T>
+{
+  return rc<T>(n, for_overwrite);
+}
+
+}  // namespace stl
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace stl {
+
+// A type is trivially relocatable when moving an object to a new address and
+// ending the lifetime of the source is equivalent to copying its bytes. Every
+// trivially copyable type qualifies; owning handles such as box, arc and vec
+// opt in through specializations next to their definitions.
+template <typename T>
+struct is_trivially_relocatable
+    : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+
+template <typename T>
+inline constexpr bool is_trivially_relocatable_v =
+    is_trivially_relocatable<std::remove_cv_t<T>>::value;
+
+// Relocates count objects from first into the uninitialized, non-overlapping
+// storage at dest. The source objects are left destroyed.
+template <typename T>
+auto relocate_n(T* first, std::size_t count, T* dest) noexcept(
+    is_trivially_relocatable_v<T> || std::is_nothrow_move_constructible_v<T>)
+    -> T* {
+  if constexpr (is_trivially_relocatable_v<T>) {
+    if (count != 0) {
+      std::memcpy(static_cast<void*>(dest), static_cast<const void*>(first),
+                  count * sizeof(T));
+    }
+    return dest + count;
+  } else {
+    T* last = std::uninitialized_move_n(first, count, dest).second;
+    std::destroy_n(first, count);
+    return last;
+  }
+}
+
+// Relocates count trivially relocatable objects from first to dest, where the
+// two ranges may overlap. Used to open or close gaps inside a buffer.
+template <typename T>
+  requires is_trivially_relocatable_v<T>
+auto relocate_overlapping_n(T* first, std::size_t count, T* dest) noexcept
+    -> T* {
+  if (count != 0) {
+    std::memmove(static_cast<void*>(dest), static_cast<const void*>(first),
+                 count * sizeof(T));
+  }
+  return dest + count;
+}
+
+}  // namespace stl
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "allocator.hpp"
+#include "arc.hpp"
+#include "box.hpp"
+#include "relocate.hpp"
+
+namespace stl {
+
+namespace detail {
+
+// Threads are numbered in the order they first touch a sharded_arc, so up to
+// shard_count() threads each get a shard of their own.
+inline auto thread_shard() noexcept -> std::size_t {
+  static std::atomic<std::size_t> next{0};
+  thread_local std::size_t index = next.fetch_add(1, std::memory_order_relaxed);
+  return index;
+}
+
+inline auto shard_count() noexcept -> std::size_t {
+  static const std::size_t count = std::bit_ceil(std::clamp<std::size_t>(
+      std::thread::hardware_concurrency(), 1, 256));
+  return count;
+}
+
+// The counts of one sharded object. Each shard holds a signed count, stored
+// doubled so that bit 0 can mark the shard as retired. While the owner lives,
+// copies and drops only touch their thread's shard, and no single shard
+// needs to stay positive. When the owner goes, every shard is retired and
+// its count moved into _central, which then counts alone and frees the table
+// at zero.
+template <typename T>
+class sharded_table {
+ public:
+  explicit sharded_table(arc<T> target)
+      : _target(std::move(target)), _shards(shard_count()) {}
+
+  auto target() const noexcept -> const arc<T>& {
+    return _target;
+  }
+
+  auto add_ref() noexcept -> void {
+    if (local().fetch_add(2, std::memory_order_relaxed) & retired) {
+      _central.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  auto release_ref() noexcept -> void {
+    if (local().fetch_sub(2, std::memory_order_release) & retired) {
+      release_central(1);
+    }
+  }
+
+  // Retires the shards and drops the owner's reference. The bias keeps
+  // _central from reaching zero while shard counts are still being moved in
+  // and drops on retired shards already land on it.
+  auto release_owner() noexcept -> void {
+    _central.fetch_add(bias, std::memory_order_relaxed);
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < shard_count(); ++i) {
+      total += _shards[i].count.fetch_or(retired, std::memory_order_acq_rel) >>
+               1;
+    }
+    // Shard counts may be negative; their sum, taken modulo 2^63, is not.
+    _central.fetch_add(total & (~std::uint64_t{0} >> 1),
+                       std::memory_order_relaxed);
+    release_central(bias + 1);
+  }
+
+ private:
+  static constexpr std::uint64_t retired = 1;
+  static constexpr std::uint64_t bias = std::uint64_t{1} << 62;
+
+  struct alignas(cache_line_size) shard {
+    std::atomic<std::uint64_t> count{0};
+  };
+
+  auto local() noexcept -> std::atomic<std::uint64_t>& {
+    return _shards[thread_shard() & (shard_count() - 1)].count;
+  }
+
+  auto release_central(std::uint64_t count) noexcept -> void {
+    if (_central.fetch_sub(count, std::memory_order_acq_rel) == count) {
+      delete this;
+    }
+  }
+
+  arc<T> _target;
+  box<shard[]> _shards;
+  // Starts at one, the owner's reference.
+  std::atomic<std::uint64_t> _central{1};
+};
+
+}  // namespace detail
+
+// Opt-in hot-object mode for an arc copied by many threads at once, such as a
+// global configuration. Copies and drops touch a per-thread counter on its
+// own cache line instead of the one count every thread shares, so they scale
+// with the thread count. The price is a cache line per hardware thread for
+// each object.
+//
+// The sharded_arc built from an arc is the owner; copies of it are not, and
+// moves carry ownership along. Counts stay sharded until the owner is gone,
+// after which the remaining copies share one count as arcs do. Keep the owner
+// for as long as the object is hot, e.g. in the global itself.
+template <typename T>
+class sharded_arc {
+ public:
+  using element_type = std::remove_extent_t<T>;
+
+  sharded_arc() noexcept : _ptr(nullptr), _table(nullptr), _owner(false) {}
+
+  explicit sharded_arc(arc<T> target)
+      : _ptr(target.get()),
+        _table(target ? new table(std::move(target)) : nullptr),
+        _owner(_table != nullptr) {}
+
+  sharded_arc(const sharded_arc& other) noexcept
+      : _ptr(other._ptr), _table(other._table), _owner(false) {
+    if (_table) {
+      _table->add_ref();
+    }
+  }
+
+  sharded_arc(sharded_arc&& other) noexcept
+      : _ptr(std::exchange(other._ptr, nullptr)),
+        _table(std::exchange(other._table, nullptr)),
+        _owner(std::exchange(other._owner, false)) {}
+
+  ~sharded_arc() {
+    release();
+  }
+
+  auto operator=(const sharded_arc& other) noexcept -> sharded_arc& {
+    if (this != &other) {
+      release();
+      _ptr = other._ptr;
+      _table = other._table;
+      _owner = false;
+      if (_table) {
+        _table->add_ref();
+      }
+    }
+    return *this;
+  }
+
+  auto operator=(sharded_arc&& other) noexcept -> sharded_arc& {
+    if (this != &other) {
+      release();
+      _ptr = std::exchange(other._ptr, nullptr);
+      _table = std::exchange(other._table, nullptr);
+      _owner = std::exchange(other._owner, false);
+    }
+    return *this;
+  }
+
+  auto owner() const noexcept -> bool {
+    return _owner;
+  }
+
+  auto get() const noexcept -> element_type* {
+    return _ptr;
+  }
+
+  explicit operator bool() const noexcept {
+    return _ptr != nullptr;
+  }
+
+  auto operator*() const -> element_type& {
+    return *_ptr;
+  }
+
+  auto operator->() const -> element_type* {
+    return _ptr;
+  }
+
+  // A plain arc to the object. Takes a reference on the shared count, so it
+  // is as contended as copying an arc.
+  auto to_arc() const noexcept -> arc<T> {
+    return _table ? _table->target() : arc<T>();
+  }
+
+  auto operator==(const sharded_arc& other) const noexcept -> bool {
+    return get() == other.get();
+  }
+
+  auto operator<=>(const sharded_arc& other) const noexcept
+      -> std::strong_ordering {
+    return get() <=> other.get();
+  }
+
+ private:
+  using table = detail::sharded_table<T>;
+
+  auto release() noexcept -> void {
+    if (!_table) {
+      return;
+    }
+    if (_owner) {
+      _table->release_owner();
+    } else {
+      _table->release_ref();
+    }
+  }
+
+  element_type* _ptr;
+  table* _table;
+  bool _owner;
+};
+
+template <typename T>
+struct is_trivially_relocatable<sharded_arc<T>> : std::true_type {};
+
+template <typename T, typename... Args>
+auto make_sharded_arc(Args&&... args) -> sharded_arc<T>
+  requires(!std::is_array_v<T>)
+{
+  return sharded_arc<T>(make_arc<T>(std::forward<Args>(args)...));
+}
+
+}  // namespace stl
@@ -0,0 +1,395 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define STL_SIMD_X86 1
+#else
+#define STL_SIMD_X86 0
+#endif
+
+// Vectorized kernels for contiguous ranges of arithmetic values. Each kernel
+// is compiled for SSE2, AVX2 and AVX-512 and the widest one the running CPU
+// supports is picked at runtime, so callers get wide vectors without building
+// the whole program for a specific microarchitecture. Elements are compared
+// with ==, so floating-point NaNs never match and -0.0 equals 0.0, exactly
+// as in the scalar algorithms.
+namespace stl::simd {
+
+enum class isa {
+  scalar,
+  sse2,
+  avx2,
+  avx512,
+};
+
+// The widest instruction set the running CPU supports, probed once.
+inline auto detected_isa() noexcept -> isa {
+#if STL_SIMD_X86
+  static const isa detected = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512bw")) {
+      return isa::avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+      return isa::avx2;
+    }
+    return isa::sse2;
+  }();
+  return detected;
+#else
+  return isa::scalar;
+#endif
+}
+
+template <typename T>
+concept vectorizable =
+    (std::is_integral_v<T> || std::is_floating_point_v<T>) &&
+    !std::is_same_v<std::remove_cv_t<T>, bool> && sizeof(T) <= 8;
+
+namespace detail {
+
+// Scalar reference kernels, also used for tails shorter than one vector.
+
+template <typename T>
+auto mismatch_scalar(const T* lhs, const T* rhs, std::size_t n) noexcept
+    -> std::size_t {
+  return static_cast<std::size_t>(std::mismatch(lhs, lhs + n, rhs).first -
+                                  lhs);
+}
+
+template <typename T>
+auto find_scalar(const T* first, std::size_t n, T value) noexcept
+    -> std::size_t {
+  return static_cast<std::size_t>(std::find(first, first + n, value) - first);
+}
+
+template <typename T>
+auto count_scalar(const T* first, std::size_t n, T value) noexcept
+    -> std::size_t {
+  return static_cast<std::size_t>(std::count(first, first + n, value));
+}
+
+template <typename T>
+auto fill_scalar(T* first, std::size_t n, T value) noexcept -> void {
+  std::fill(first, first + n, value);
+}
+
+template <typename T>
+auto min_scalar(const T* first, std::size_t n) noexcept -> T {
+  return *std::min_element(first, first + n);
+}
+
+template <typename T>
+auto max_scalar(const T* first, std::size_t n) noexcept -> T {
+  return *std::max_element(first, first + n);
+}
+
+#if STL_SIMD_X86
+
+// Width-generic kernels written with GCC/Clang vector extensions. They are
+// always inlined into the per-ISA entry points below, whose target attribute
+// decides which instructions the vector operations lower to.
+
+template <typename T, std::size_t Bytes>
+struct lanes {
+  using type [[gnu::vector_size(Bytes)]] = T;
+};
+
+template <std::size_t Bytes>
+struct words {
+  using type [[gnu::vector_size(Bytes)]] = std::uint64_t;
+};
+
+template <typename T, std::size_t Bytes>
+using vector_t = typename lanes<T, Bytes>::type;
+
+// Vectors are passed by reference throughout: passing them by value from a
+// function compiled without the wider ISA would change the calling convention.
+
+template <typename T, std::size_t Bytes>
+[[gnu::always_inline]] inline auto load(const T* ptr,
+                                        vector_t<T, Bytes>& out) noexcept
+    -> void {
+  std::memcpy(&out, ptr, Bytes);
+}
+
+template <typename T, std::size_t Bytes>
+[[gnu::always_inline]] inline auto broadcast(T value,
+                                             vector_t<T, Bytes>& out) noexcept
+    -> void {
+  for (std::size_t lane = 0; lane < Bytes / sizeof(T); ++lane) {
+    out[lane] = value;
+  }
+}
+
+// True if any lane of a comparison mask is set.
+template <std::size_t Bytes, typename Mask>
+[[gnu::always_inline]] inline auto any(const Mask& mask) noexcept -> bool {
+  typename words<Bytes>::type bits;
+  std::memcpy(&bits, &mask, Bytes);
+  std::uint64_t merged = 0;
+  for (std::size_t word = 0; word < Bytes / 8; ++word) {
+    merged |= bits[word];
+  }
+  return merged != 0;
+}
+
+template <std::size_t Bytes, typename T>
+[[gnu::always_inline]] inline auto mismatch_kernel(const T* lhs,
+                                                   const T* rhs,
+                                                   std::size_t n) noexcept
+    -> std::size_t {
+  constexpr std::size_t step = Bytes / sizeof(T);
+  vector_t<T, Bytes> left;
+  vector_t<T, Bytes> right;
+  std::size_t i = 0;
+  for (; i + step <= n; i += step) {
+    load<T, Bytes>(lhs + i, left);
+    load<T, Bytes>(rhs + i, right);
+    auto differs = left != right;
+    if (any<Bytes>(differs)) {
+      break;
+    }
+  }
+  return i + mismatch_scalar(lhs + i, rhs + i, n - i);
+}
+
+template <std::size_t Bytes, typename T>
+[[gnu::always_inline]] inline auto find_kernel(const T* first,
+                                               std::size_t n,
+                                               T value) noexcept
+    -> std::size_t {
+  constexpr std::size_t step = Bytes / sizeof(T);
+  vector_t<T, Bytes> needle;
+  vector_t<T, Bytes> block;
+  broadcast<T, Bytes>(value, needle);
+  std::size_t i = 0;
+  for (; i + step <= n; i += step) {
+    load<T, Bytes>(first + i, block);
+    auto matches = block == needle;
+    if (any<Bytes>(matches)) {
+      break;
+    }
+  }
+  return i + find_scalar(first + i, n - i, value);
+}
+
+template <std::size_t Bytes, typename T>
+[[gnu::always_inline]] inline auto count_kernel(const T* first,
+                                                std::size_t n,
+                                                T value) noexcept
+    -> std::size_t {
+  constexpr std::size_t step = Bytes / sizeof(T);
+  vector_t<T, Bytes> needle;
+  vector_t<T, Bytes> block;
+  using mask_t = decltype(needle == block);
+  using lane_t = std::remove_cvref_t<decltype(std::declval<mask_t&>()[0])>;
+  // Matching lanes are -1; subtracting them counts per lane until the lane
+  // type would overflow, at which point the partial sums are flushed.
+  constexpr std::size_t flush_every = std::min<std::size_t>(
+      std::numeric_limits<lane_t>::max(), std::size_t{1} << 20);
+
+  broadcast<T, Bytes>(value, needle);
+  std::size_t total = 0;
+  std::size_t i = 0;
+  while (i + step <= n) {
+    mask_t counts{};
+    std::size_t blocks = 0;
+    for (; blocks < flush_every && i + step <= n; ++blocks, i += step) {
+      load<T, Bytes>(first + i, block);
+      counts -= block == needle;
+    }
+    for (std::size_t lane = 0; lane < step; ++lane) {
+      total += static_cast<std::size_t>(counts[lane]);
+    }
+  }
+  return total + count_scalar(first + i, n - i, value);
+}
+
+template <std::size_t Bytes, typename T>
+[[gnu::always_inline]] inline auto fill_kernel(T* first,
+                                               std::size_t n,
+                                               T value) noexcept -> void {
+  constexpr std::size_t step = Bytes / sizeof(T);
+  vector_t<T, Bytes> splat;
+  broadcast<T, Bytes>(value, splat);
+  std::size_t i = 0;
+  for (; i + step <= n; i += step) {
+    std::memcpy(first + i, &splat, Bytes);
+  }
+  fill_scalar(first + i, n - i, value);
+}
+
+// Lane-wise reduction to the smallest (Min) or largest element.
+template <std::size_t Bytes, bool Min, typename T>
+[[gnu::always_inline]] inline auto extremum_kernel(const T* first,
+                                                   std::size_t n) noexcept
+    -> T {
+  constexpr std::size_t step = Bytes / sizeof(T);
+  if (n < step) {
+    return Min ? min_scalar(first, n) : max_scalar(first, n);
+  }
+  vector_t<T, Bytes> best;
+  vector_t<T, Bytes> next;
+  load<T, Bytes>(first, best);
+  std::size_t i = step;
+  for (; i + step <= n; i += step) {
+    load<T, Bytes>(first + i, next);
+    if constexpr (Min) {
+      best = next < best ? next : best;
+    } else {
+      best = best < next ? next : best;
+    }
+  }
+  T result = best[0];
+  for (std::size_t lane = 1; lane < step; ++lane) {
+    if constexpr (Min) {
+      result = best[lane] < result ? best[lane] : result;
+    } else {
+      result = result < best[lane] ? best[lane] : result;
+    }
+  }
+  for (; i < n; ++i) {
+    if constexpr (Min) {
+      result = first[i] < result ? first[i] : result;
+    } else {
+      result = result < first[i] ? first[i] : result;
+    }
+  }
+  return result;
+}
+
+// Stamps out the entry points for one instruction set.
+#define STL_SIMD_DEFINE_ISA(suffix, features, bytes)                         \
+  template <typename T>                                                      \
+  [[gnu::target(features)]] auto mismatch_##suffix(                          \
+      const T* lhs, const T* rhs, std::size_t n) noexcept -> std::size_t {   \
+    return mismatch_kernel<bytes>(lhs, rhs, n);                              \
+  }                                                                          \
+  template <typename T>                                                      \
+  [[gnu::target(features)]] auto find_##suffix(const T* first, std::size_t n,\
+                                             T value) noexcept               \
+      -> std::size_t {                                                       \
+    return find_kernel<bytes>(first, n, value);                              \
+  }                                                                          \
+  template <typename T>                                                      \
+  [[gnu::target(features)]] auto count_##suffix(const T* first, std::size_t n,\
+                                              T value) noexcept              \
+      -> std::size_t {                                                       \
+    return count_kernel<bytes>(first, n, value);                             \
+  }                                                                          \
+  template <typename T>                                                      \
+  [[gnu::target(features)]] auto fill_##suffix(T* first, std::size_t n,      \
+                                             T value) noexcept -> void {     \
+    fill_kernel<bytes>(first, n, value);                                     \
+  }                                                                          \
+  template <typename T>                                                      \
+  [[gnu::target(features)]] auto min_##suffix(const T* first,                \
+                                            std::size_t n) noexcept -> T {   \
+    return extremum_kernel<bytes, true>(first, n);                           \
+  }                                                                          \
+  template <typename T>                                                      \
+  [[gnu::target(features)]] auto max_##suffix(const T* first,                \
+                                            std::size_t n) noexcept -> T {   \
+    return extremum_kernel<bytes, false>(first, n);                          \
+  }
+
+STL_SIMD_DEFINE_ISA(sse2, "sse2", 16)
+STL_SIMD_DEFINE_ISA(avx2, "avx2", 32)
+STL_SIMD_DEFINE_ISA(avx512, "avx512f,avx512bw", 64)
+
+#undef STL_SIMD_DEFINE_ISA
+
+#define STL_SIMD_DISPATCH(kernel, ...)                 \
+  switch (detected_isa()) {                            \
+    case isa::avx512:                                  \
+      return detail::kernel##_avx512(__VA_ARGS__);     \
+    case isa::avx2:                                    \
+      return detail::kernel##_avx2(__VA_ARGS__);       \
+    case isa::sse2:                                    \
+      return detail::kernel##_sse2(__VA_ARGS__);       \
+    default:                                           \
+      return detail::kernel##_scalar(__VA_ARGS__);     \
+  }
+
+#else
+
+#define STL_SIMD_DISPATCH(kernel, ...) \
+  return detail::kernel##_scalar(__VA_ARGS__);
+
+#endif
+
+}  // namespace detail
+
+// Index of the first position where lhs and rhs differ, or n.
+template <vectorizable T>
+auto mismatch(const T* lhs, const T* rhs, std::size_t n) noexcept
+    -> std::size_t {
+  STL_SIMD_DISPATCH(mismatch, lhs, rhs, n)
+}
+
+template <vectorizable T>
+auto equal(const T* lhs, const T* rhs, std::size_t n) noexcept -> bool {
+  return simd::mismatch(lhs, rhs, n) == n;
+}
+
+// Index of the first element equal to value, or n.
+template <vectorizable T>
+auto find(const T* first, std::size_t n, T value) noexcept -> std::size_t {
+  STL_SIMD_DISPATCH(find, first, n, value)
+}
+
+template <vectorizable T>
+auto count(const T* first, std::size_t n, T value) noexcept -> std::size_t {
+  STL_SIMD_DISPATCH(count, first, n, value)
+}
+
+template <vectorizable T>
+auto contains(const T* first, std::size_t n, T value) noexcept -> bool {
+  return simd::find(first, n, value) != n;
+}
+
+template <vectorizable T>
+auto fill(T* first, std::size_t n, T value) noexcept -> void {
+  STL_SIMD_DISPATCH(fill, first, n, value)
+}
+
+// Smallest and largest element of a non-empty range. With NaNs present the
+// result is unspecified.
+template <vectorizable T>
+auto min(const T* first, std::size_t n) noexcept -> T {
+  STL_SIMD_DISPATCH(min, first, n)
+}
+
+template <vectorizable T>
+auto max(const T* first, std::size_t n) noexcept -> T {
+  STL_SIMD_DISPATCH(max, first, n)
+}
+
+#undef STL_SIMD_DISPATCH
+
+// Range overloads for vec, arr and other contiguous containers.
+
+template <std::ranges::contiguous_range Range>
+  requires vectorizable<std::ranges::range_value_t<Range>>
+auto min(const Range& range) noexcept -> std::ranges::range_value_t<Range> {
+  return simd::min(std::ranges::data(range), std::ranges::size(range));
+}
+
+template <std::ranges::contiguous_range Range>
+  requires vectorizable<std::ranges::range_value_t<Range>>
+auto max(const Range& range) noexcept -> std::ranges::range_value_t<Range> {
+  return simd::max(std::ranges::data(range), std::ranges::size(range));
+}
+
+}  // namespace stl::simd
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+namespace stl {
+
+namespace detail {
+
+// Free lists of fixed-size blocks: one per thread, plus a shared one that
+// threads hand surplus blocks to and refill from in batches. Blocks are
+// carved from slabs that are never returned to the system, so the pool's
+// footprint is its high-water mark.
+template <std::size_t Size, std::size_t Align>
+class slab_pool {
+  struct node {
+    node* next;
+  };
+
+  static constexpr std::size_t block_align = std::max(Align, alignof(node));
+  static constexpr std::size_t block_size =
+      (std::max(Size, sizeof(node)) + block_align - 1) & ~(block_align - 1);
+  static constexpr std::size_t slab_size =
+      std::max<std::size_t>(std::size_t{64} << 10, block_size * 16);
+  // Blocks moved between a thread and the shared list at a time.
+  static constexpr std::size_t batch = 64;
+
+ public:
+  static auto allocate() -> void* {
+    cache& local = local_cache();
+    if (!local.head) {
+      refill(local);
+    }
+    node* block = local.head;
+    local.head = block->next;
+    --local.count;
+    return block;
+  }
+
+  static auto deallocate(void* ptr) noexcept -> void {
+    cache& local = local_cache();
+    local.head = ::new (ptr) node{local.head};
+    if (++local.count >= 2 * batch) {
+      give_back(local, batch);
+    }
+  }
+
+ private:
+  // Trivially destructible, so it stays usable while other thread_locals
+  // are destroyed; flusher returns its blocks when the thread exits.
+  struct cache {
+    node* head;
+    std::size_t count;
+  };
+
+  struct flusher {
+    ~flusher() {
+      cache& local = local_cache();
+      give_back(local, local.count);
+    }
+  };
+
+  struct shared_list {
+    std::mutex mutex;
+    node* head = nullptr;
+  };
+
+  static auto local_cache() noexcept -> cache& {
+    thread_local cache local{nullptr, 0};
+    thread_local flusher flush_on_exit;
+    return local;
+  }
+
+  // Never destroyed: threads may still return blocks during static
+  // destruction.
+  static auto shared() -> shared_list& {
+    static shared_list* list = new shared_list;
+    return *list;
+  }
+
+  static auto refill(cache& local) -> void {
+    {
+      shared_list& list = shared();
+      std::lock_guard lock(list.mutex);
+      while (list.head && local.count < batch) {
+        node* block = list.head;
+        list.head = block->next;
+        block->next = local.head;
+        local.head = block;
+        ++local.count;
+      }
+    }
+    if (local.head) {
+      return;
+    }
+    auto* slab = static_cast<std::byte*>(
+        ::operator new(slab_size, std::align_val_t{block_align}));
+    for (std::size_t offset = 0; offset + block_size <= slab_size;
+         offset += block_size) {
+      local.head = ::new (slab + offset) node{local.head};
+      ++local.count;
+    }
+  }
+
+  static auto give_back(cache& local, std::size_t count) noexcept -> void {
+    if (count == 0) {
+      return;
+    }
+    node* first = local.head;
+    node* last = first;
+    for (std::size_t i = 1; i < count; ++i) {
+      last = last->next;
+    }
+    local.head = last->next;
+    local.count -= count;
+    shared_list& list = shared();
+    std::lock_guard lock(list.mutex);
+    last->next = list.head;
+    list.head = first;
+  }
+};
+
+}  // namespace detail
+
+// Stateless allocator that serves single-object allocations from a
+// thread-caching slab pool per object size, which makes allocating and
+// freeing a small fixed-size object, such as an arc control block, a few
+// pointer moves. Multi-object requests go to std::allocator.
+template <typename T>
+class slab_allocator {
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using propagate_on_container_move_assignment = std::true_type;
+  using is_always_equal = std::true_type;
+
+  constexpr slab_allocator() noexcept = default;
+
+  template <typename U>
+  constexpr slab_allocator(const slab_allocator<U>&) noexcept {}
+
+  [[nodiscard]] auto allocate(size_type n) -> T* {
+    if (n == 1) {
+      return static_cast<T*>(pool_for<>::allocate());
+    }
+    return std::allocator<T>().allocate(n);
+  }
+
+  auto deallocate(T* ptr, size_type n) noexcept -> void {
+    if (n == 1) {
+      pool_for<>::deallocate(ptr);
+    } else {
+      std::allocator<T>().deallocate(ptr, n);
+    }
+  }
+
+  template <typename U>
+  constexpr auto operator==(const slab_allocator<U>&) const noexcept -> bool {
+    return true;
+  }
+
+ private:
+  // Named through a member template so that T may still be incomplete where
+  // slab_allocator<T> is, as in a block that stores its own allocator.
+  template <typename U = T>
+  using pool_for = detail::slab_pool<sizeof(U), alignof(U)>;
+};
+
+}  // namespace stl
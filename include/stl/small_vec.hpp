@@ -0,0 +1,687 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <format>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "allocator.hpp"
+#include "buffer_ops.hpp"
+#include "growth.hpp"
+#include "relocate.hpp"
+#include "simd.hpp"
+
+namespace stl {
+
+// A vec that keeps up to N elements inside the object and only allocates
+// once it outgrows them. Past N it behaves like vec: capacity follows the
+// Growth policy, and trivially relocatable elements grow through
+// Allocator::reallocate when the allocator has one. shrink_to_fit() moves
+// the elements back inline when they fit.
+//
+// The inline buffer makes small_vec address-dependent: moving an inline
+// small_vec moves its elements one by one, and the type is never trivially
+// relocatable. Allocators are assumed stateless.
+template <typename T,
+          std::size_t N,
+          typename Allocator = stl::allocator<T>,
+          typename Growth = doubling_growth>
+class small_vec {
+  using alloc_traits = std::allocator_traits<Allocator>;
+
+  static_assert(N > 0, "small_vec: inline capacity must be positive");
+  static_assert(std::is_same_v<typename alloc_traits::value_type, T>,
+                "small_vec: Allocator::value_type must match T");
+  static_assert(std::is_same_v<typename alloc_traits::pointer, T*>,
+                "small_vec: fancy allocator pointers are not supported");
+  static_assert(alloc_traits::is_always_equal::value,
+                "small_vec: allocators must be stateless");
+
+ public:
+  using value_type = T;
+  using allocator_type = Allocator;
+  using growth_policy = Growth;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
+  using iterator = pointer;
+  using const_iterator = const_pointer;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  static constexpr size_type inline_capacity = N;
+
+  small_vec() noexcept : _size(0), _capacity(N), _buffer(inline_data()) {}
+
+  explicit small_vec(size_type count) : small_vec() {
+    resize(count);
+  }
+
+  small_vec(size_type count, const T& value)
+    requires std::copyable<T>
+      : small_vec() {
+    resize(count, value);
+  }
+
+  small_vec(const small_vec& other) : small_vec() {
+    assign(other.begin(), other.end());
+  }
+
+  small_vec(small_vec&& other) noexcept(
+      std::is_nothrow_move_constructible_v<T>)
+      : small_vec() {
+    take(other);
+  }
+
+  small_vec(std::initializer_list<T> init)
+    requires std::copyable<T>
+      : small_vec(init.begin(), init.end()) {}
+
+  template <typename Iterator>
+  small_vec(Iterator first, Iterator last)
+    requires std::input_iterator<Iterator> &&
+                 std::constructible_from<
+                     T,
+                     typename std::iterator_traits<Iterator>::reference>
+      : small_vec() {
+    assign(first, last);
+  }
+
+  ~small_vec() {
+    clear();
+    release_heap();
+  }
+
+  auto operator=(const small_vec& other) -> small_vec& {
+    if (this != &other) {
+      assign(other.begin(), other.end());
+    }
+    return *this;
+  }
+
+  auto operator=(small_vec&& other) noexcept(
+      std::is_nothrow_move_constructible_v<T>) -> small_vec& {
+    if (this != &other) {
+      clear();
+      release_heap();
+      take(other);
+    }
+    return *this;
+  }
+
+  auto operator=(std::initializer_list<T> init) -> small_vec& {
+    assign(init.begin(), init.end());
+    return *this;
+  }
+
+  auto assign(size_type count, const T& value) -> void {
+    clear();
+    reserve(count);
+    ops::fill_construct_n(_alloc, _buffer, count, value);
+    _size = count;
+  }
+
+  template <typename InputIt>
+    requires std::input_iterator<InputIt>
+  auto assign(InputIt first, InputIt last) -> void {
+    clear();
+    if constexpr (std::forward_iterator<InputIt>) {
+      size_type count = std::distance(first, last);
+      reserve(count);
+      ops::copy_construct_n(_alloc, first, count, _buffer);
+      _size = count;
+    } else {
+      for (; first != last; ++first) {
+        emplace_back(*first);
+      }
+    }
+  }
+
+  auto assign(std::initializer_list<T> init) -> void {
+    assign(init.begin(), init.end());
+  }
+
+  auto get_allocator() const noexcept -> allocator_type {
+    return _alloc;
+  }
+
+  auto at(size_type pos) -> reference {
+    if (pos >= _size) {
+      throw std::out_of_range(std::format(
+          "small_vec::at: position {} out of range {}", pos, _size));
+    }
+    return _buffer[pos];
+  }
+
+  auto at(size_type pos) const -> const_reference {
+    if (pos >= _size) {
+      throw std::out_of_range(std::format(
+          "small_vec::at: position {} out of range {}", pos, _size));
+    }
+    return _buffer[pos];
+  }
+
+  auto operator[](size_type pos) -> reference {
+    return _buffer[pos];
+  }
+
+  auto operator[](size_type pos) const -> const_reference {
+    return _buffer[pos];
+  }
+
+  auto front() -> reference {
+    return _buffer[0];
+  }
+
+  auto front() const -> const_reference {
+    return _buffer[0];
+  }
+
+  auto back() -> reference {
+    return _buffer[_size - 1];
+  }
+
+  auto back() const -> const_reference {
+    return _buffer[_size - 1];
+  }
+
+  auto data() noexcept -> pointer {
+    return _buffer;
+  }
+
+  auto data() const noexcept -> const_pointer {
+    return _buffer;
+  }
+
+  auto begin() noexcept -> iterator {
+    return _buffer;
+  }
+
+  auto begin() const noexcept -> const_iterator {
+    return _buffer;
+  }
+
+  auto end() noexcept -> iterator {
+    return _buffer + _size;
+  }
+
+  auto end() const noexcept -> const_iterator {
+    return _buffer + _size;
+  }
+
+  auto rbegin() noexcept -> reverse_iterator {
+    return reverse_iterator(end());
+  }
+
+  auto rbegin() const noexcept -> const_reverse_iterator {
+    return const_reverse_iterator(end());
+  }
+
+  auto rend() noexcept -> reverse_iterator {
+    return reverse_iterator(begin());
+  }
+
+  auto rend() const noexcept -> const_reverse_iterator {
+    return const_reverse_iterator(begin());
+  }
+
+  auto empty() const noexcept -> bool {
+    return _size == 0;
+  }
+
+  auto size() const noexcept -> size_type {
+    return _size;
+  }
+
+  auto capacity() const noexcept -> size_type {
+    return _capacity;
+  }
+
+  // True while the elements live in the inline buffer.
+  auto is_inline() const noexcept -> bool {
+    return _buffer == inline_data();
+  }
+
+  auto reserve(size_type new_cap) -> void {
+    if (new_cap > _capacity) {
+      reallocate(new_cap);
+    }
+  }
+
+  auto shrink_to_fit() -> void {
+    if (!is_inline() && _size < _capacity) {
+      reallocate(_size);
+    }
+  }
+
+  auto clear() noexcept -> void {
+    ops::destroy_n(_alloc, _buffer, _size);
+    _size = 0;
+  }
+
+  auto push_back(const T& value) -> void
+    requires std::copyable<T>
+  {
+    emplace_back(value);
+  }
+
+  auto push_back(T&& value) -> void
+    requires std::movable<T>
+  {
+    emplace_back(std::move(value));
+  }
+
+  template <typename... Args>
+  auto emplace_back(Args&&... args) -> reference
+    requires std::constructible_from<T, Args...>
+  {
+    if (_size == _capacity) [[unlikely]] {
+      // args may refer into this small_vec; build the element first.
+      T value(std::forward<Args>(args)...);
+      grow(_size + 1);
+      alloc_traits::construct(_alloc, _buffer + _size, std::move(value));
+    } else {
+      alloc_traits::construct(_alloc, _buffer + _size,
+                              std::forward<Args>(args)...);
+    }
+    ++_size;
+    return back();
+  }
+
+  // Appends without checking capacity. The caller must have reserved room,
+  // i.e. size() < capacity().
+  auto unchecked_push_back(const T& value) -> void
+    requires std::copyable<T>
+  {
+    alloc_traits::construct(_alloc, _buffer + _size, value);
+    ++_size;
+  }
+
+  auto unchecked_push_back(T&& value) -> void
+    requires std::movable<T>
+  {
+    alloc_traits::construct(_alloc, _buffer + _size, std::move(value));
+    ++_size;
+  }
+
+  template <typename... Args>
+  auto unchecked_emplace_back(Args&&... args) -> reference
+    requires std::constructible_from<T, Args...>
+  {
+    alloc_traits::construct(_alloc, _buffer + _size,
+                            std::forward<Args>(args)...);
+    ++_size;
+    return back();
+  }
+
+  // Appends count elements read from first, reserving once up front.
+  template <typename InputIt>
+    requires std::input_iterator<InputIt>
+  auto append_n(InputIt first, size_type count) -> void {
+    if (_size + count > _capacity) {
+      grow(_size + count);
+    }
+    ops::copy_construct_n(_alloc, first, count, _buffer + _size);
+    _size += count;
+  }
+
+  template <std::ranges::input_range Range>
+  auto append_range(Range&& range) -> void {
+    if constexpr (std::ranges::forward_range<Range> ||
+                  std::ranges::sized_range<Range>) {
+      auto count = static_cast<size_type>(std::ranges::distance(range));
+      append_n(std::ranges::begin(range), count);
+    } else {
+      for (auto&& value : range) {
+        emplace_back(std::forward<decltype(value)>(value));
+      }
+    }
+  }
+
+  template <typename... Args>
+  auto emplace(const_iterator pos, Args&&... args) -> iterator
+    requires std::constructible_from<T, Args...>
+  {
+    size_type index = pos - begin();
+    if (_size == _capacity || index == _size) {
+      // Neither path moves existing elements before the new one is built, so
+      // args may safely refer into this small_vec.
+      return insert_with(index, 1, [&](pointer slot) {
+        alloc_traits::construct(_alloc, slot, std::forward<Args>(args)...);
+      });
+    }
+    T value(std::forward<Args>(args)...);
+    return insert_with(index, 1, [&](pointer slot) {
+      alloc_traits::construct(_alloc, slot, std::move(value));
+    });
+  }
+
+  auto insert(const_iterator pos, const T& value) -> iterator
+    requires std::copyable<T>
+  {
+    return emplace(pos, value);
+  }
+
+  auto insert(const_iterator pos, T&& value) -> iterator
+    requires std::movable<T>
+  {
+    return emplace(pos, std::move(value));
+  }
+
+  auto insert(const_iterator pos, size_type count, const T& value) -> iterator
+    requires std::copyable<T>
+  {
+    size_type index = pos - begin();
+    if (std::less_equal<const T*>{}(data(), std::addressof(value)) &&
+        std::less<const T*>{}(std::addressof(value), data() + _size)) {
+      T copy(value);
+      return insert_with(index, count, [&](pointer slot) {
+        alloc_traits::construct(_alloc, slot, copy);
+      });
+    }
+    return insert_with(index, count, [&](pointer slot) {
+      alloc_traits::construct(_alloc, slot, value);
+    });
+  }
+
+  template <typename InputIt>
+    requires std::input_iterator<InputIt>
+  auto insert(const_iterator pos, InputIt first, InputIt last) -> iterator {
+    size_type index = pos - begin();
+    if constexpr (std::forward_iterator<InputIt>) {
+      size_type count = std::distance(first, last);
+      return insert_with(index, count, [&](pointer slot) {
+        alloc_traits::construct(_alloc, slot, *first);
+        ++first;
+      });
+    } else {
+      size_type old_size = _size;
+      for (; first != last; ++first) {
+        emplace_back(*first);
+      }
+      std::rotate(begin() + index, begin() + old_size, end());
+      return begin() + index;
+    }
+  }
+
+  auto insert(const_iterator pos, std::initializer_list<T> init) -> iterator {
+    return insert(pos, init.begin(), init.end());
+  }
+
+  auto erase(const_iterator pos) -> iterator {
+    return erase(pos, pos + 1);
+  }
+
+  auto erase(const_iterator first, const_iterator last) -> iterator {
+    size_type index = first - begin();
+    size_type count = last - first;
+    if (count != 0) {
+      ops::erase_n(_alloc, _buffer, _size, index, count);
+      _size -= count;
+    }
+    return _buffer + index;
+  }
+
+  // Erases pos in O(1) by moving the last element into its place. Does not
+  // preserve the order of the remaining elements.
+  auto swap_remove(const_iterator pos) -> iterator {
+    size_type index = pos - begin();
+    ops::swap_remove(_alloc, _buffer, _size, index);
+    --_size;
+    return _buffer + index;
+  }
+
+  auto pop_back() -> void {
+    if (_size > 0) {
+      --_size;
+      alloc_traits::destroy(_alloc, _buffer + _size);
+    }
+  }
+
+  auto resize(size_type count) -> void {
+    if (count > _size) {
+      reserve(count);
+      ops::value_construct_n(_alloc, _buffer + _size, count - _size);
+    } else if (count < _size) {
+      ops::destroy_n(_alloc, _buffer + count, _size - count);
+    }
+    _size = count;
+  }
+
+  auto resize(size_type count, const T& value) -> void {
+    if (count > _size) {
+      T copy(value);
+      reserve(count);
+      ops::fill_construct_n(_alloc, _buffer + _size, count - _size, copy);
+    } else if (count < _size) {
+      ops::destroy_n(_alloc, _buffer + count, _size - count);
+    }
+    _size = count;
+  }
+
+  // Like resize, but new elements are default-initialized, so trivial types
+  // are left uninitialized rather than zeroed.
+  auto resize_for_overwrite(size_type count) -> void {
+    if (count > _size) {
+      reserve(count);
+      ops::default_construct_n(_alloc, _buffer + _size, count - _size);
+    } else if (count < _size) {
+      ops::destroy_n(_alloc, _buffer + count, _size - count);
+    }
+    _size = count;
+  }
+
+  // Grows the storage to count elements without initializing them and calls
+  // op(data(), count). op writes the buffer and returns how many leading
+  // elements it produced; the small_vec is then truncated to that size.
+  template <typename Operation>
+    requires std::is_trivially_default_constructible_v<T> &&
+             std::is_trivially_destructible_v<T> &&
+             std::is_invocable_r_v<size_type, Operation&, pointer, size_type>
+  auto resize_and_overwrite(size_type count, Operation op) -> void {
+    reserve(count);
+    size_type written = std::move(op)(_buffer, count);
+    _size = std::min(written, count);
+  }
+
+  auto swap(small_vec& other) noexcept(
+      std::is_nothrow_move_constructible_v<T>) -> void {
+    if (!is_inline() && !other.is_inline()) {
+      std::swap(_size, other._size);
+      std::swap(_capacity, other._capacity);
+      std::swap(_buffer, other._buffer);
+    } else {
+      small_vec tmp(std::move(other));
+      other = std::move(*this);
+      *this = std::move(tmp);
+    }
+  }
+
+  auto find(const T& value) -> iterator {
+    if constexpr (simd::vectorizable<T>) {
+      return begin() + simd::find(data(), _size, value);
+    } else {
+      return std::find(begin(), end(), value);
+    }
+  }
+
+  auto find(const T& value) const -> const_iterator {
+    return const_cast<small_vec&>(*this).find(value);
+  }
+
+  auto count(const T& value) const -> size_type {
+    if constexpr (simd::vectorizable<T>) {
+      return simd::count(data(), _size, value);
+    } else {
+      return std::count(begin(), end(), value);
+    }
+  }
+
+  auto contains(const T& value) const -> bool {
+    return find(value) != end();
+  }
+
+  auto operator==(const small_vec& other) const -> bool {
+    return std::equal(begin(), end(), other.begin(), other.end());
+  }
+
+  auto operator<=>(const small_vec& other) const
+    requires std::three_way_comparable<T>
+  {
+    return std::lexicographical_compare_three_way(begin(), end(),
+                                                  other.begin(), other.end());
+  }
+
+ private:
+  using ops = detail::buffer_ops<T, Allocator>;
+
+  static constexpr bool _can_reallocate =
+      is_trivially_relocatable_v<T> &&
+      requires(Allocator& alloc, T* ptr, size_type n) {
+        { alloc.reallocate(ptr, n, n) } -> std::same_as<T*>;
+      };
+
+  auto inline_data() noexcept -> pointer {
+    return reinterpret_cast<pointer>(_inline);
+  }
+
+  auto inline_data() const noexcept -> const_pointer {
+    return reinterpret_cast<const_pointer>(_inline);
+  }
+
+  auto grow(size_type required) -> void {
+    reserve(Growth::next_capacity(_capacity, required, sizeof(T)));
+  }
+
+  auto release_heap() noexcept -> void {
+    if (!is_inline()) {
+      alloc_traits::deallocate(_alloc, _buffer, _capacity);
+      _buffer = inline_data();
+      _capacity = N;
+    }
+  }
+
+  // Moves the contents of other into *this, which must be empty and inline,
+  // and leaves other empty. A heap buffer is stolen outright.
+  auto take(small_vec& other) -> void {
+    if (other.is_inline()) {
+      ops::transfer_n(_alloc, other._buffer, other._size, _buffer);
+      ops::release_transferred(_alloc, other._buffer, other._size);
+      _size = std::exchange(other._size, 0);
+    } else {
+      _buffer = std::exchange(other._buffer, other.inline_data());
+      _size = std::exchange(other._size, 0);
+      _capacity = std::exchange(other._capacity, N);
+    }
+  }
+
+  // Moves the elements to storage of new_cap slots, which is the inline
+  // buffer whenever they fit.
+  auto reallocate(size_type new_cap) -> void {
+    if (new_cap <= N) {
+      if (!is_inline()) {
+        pointer heap = _buffer;
+        ops::transfer_n(_alloc, heap, _size, inline_data());
+        ops::release_transferred(_alloc, heap, _size);
+        alloc_traits::deallocate(_alloc, heap, _capacity);
+        _buffer = inline_data();
+        _capacity = N;
+      }
+      return;
+    }
+    if constexpr (_can_reallocate) {
+      if (!is_inline()) {
+        _buffer = _alloc.reallocate(_buffer, _capacity, new_cap);
+        _capacity = new_cap;
+        return;
+      }
+    }
+    pointer new_buffer = alloc_traits::allocate(_alloc, new_cap);
+    try {
+      ops::transfer_n(_alloc, _buffer, _size, new_buffer);
+    } catch (...) {
+      alloc_traits::deallocate(_alloc, new_buffer, new_cap);
+      throw;
+    }
+    adopt(new_buffer, new_cap);
+  }
+
+  // Releases the current elements, already transferred to new_buffer, and
+  // their storage, and switches to new_buffer.
+  auto adopt(pointer new_buffer, size_type new_cap) noexcept -> void {
+    ops::release_transferred(_alloc, _buffer, _size);
+    release_heap();
+    _buffer = new_buffer;
+    _capacity = new_cap;
+  }
+
+  // Opens a gap of count slots at index, fills it by calling make(slot) for
+  // each slot and returns an iterator to the first new element. Past the
+  // current capacity this is vec's growth path, which builds the new
+  // elements before touching the old ones.
+  template <typename Make>
+  auto insert_with(size_type index, size_type count, Make make) -> iterator {
+    if (count == 0) {
+      return _buffer + index;
+    }
+    if (_size + count > _capacity) {
+      size_type new_cap =
+          Growth::next_capacity(_capacity, _size + count, sizeof(T));
+      pointer new_buffer = alloc_traits::allocate(_alloc, new_cap);
+      try {
+        ops::insert_into(_alloc, _buffer, _size, index, count, new_buffer,
+                         make);
+      } catch (...) {
+        alloc_traits::deallocate(_alloc, new_buffer, new_cap);
+        throw;
+      }
+      adopt(new_buffer, new_cap);
+    } else {
+      ops::insert_in_place(_alloc, _buffer, _size, index, count, make);
+    }
+    _size += count;
+    return _buffer + index;
+  }
+
+  [[no_unique_address]] allocator_type _alloc;
+  size_type _size;
+  size_type _capacity;
+  pointer _buffer;
+  alignas(T) std::byte _inline[N * sizeof(T)];
+};
+
+// Removes every element matching pred in a single compacting pass.
+template <typename T,
+          std::size_t N,
+          typename Allocator,
+          typename Growth,
+          typename Pred>
+auto erase_if(small_vec<T, N, Allocator, Growth>& values, Pred pred) ->
+    typename small_vec<T, N, Allocator, Growth>::size_type {
+  return detail::erase_if_compacting(values, pred);
+}
+
+template <typename T,
+          std::size_t N,
+          typename Allocator,
+          typename Growth,
+          typename U>
+auto erase(small_vec<T, N, Allocator, Growth>& values, const U& value) ->
+    typename small_vec<T, N, Allocator, Growth>::size_type {
+  return erase_if(values, [&](const T& element) { return element == value; });
+}
+
+}  // namespace stl
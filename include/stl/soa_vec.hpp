@@ -0,0 +1,480 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "allocator.hpp"
+#include "growth.hpp"
+#include "relocate.hpp"
+
+namespace stl {
+
+// Structure-of-arrays vector: each field type in Ts gets its own contiguous,
+// cache-line-aligned column, and all columns share one size and capacity.
+// A scan over one field touches only that field's bytes and vectorizes like
+// a plain array; column<I>() exposes field I as a span, and iteration yields
+// tuples of references across all fields.
+//
+// Capacity grows by Growth, a vec growth policy applied to the bytes of one
+// row; soa_vec grows like vec's default. Growing allocates every column
+// before moving any, and moves relocate trivially relocatable fields
+// bytewise, so fields must be nothrow move constructible for the columns to
+// stay in step.
+template <typename Growth, typename... Ts>
+class basic_soa_vec {
+  static_assert(sizeof...(Ts) > 0, "soa_vec: needs at least one field");
+  static_assert((std::is_nothrow_move_constructible_v<Ts> && ...),
+                "soa_vec: fields must be nothrow move constructible");
+  static_assert((std::is_same_v<Ts, std::remove_cvref_t<Ts>> && ...),
+                "soa_vec: fields must be unqualified object types");
+
+  template <bool Const>
+  class basic_iterator;
+
+  using indices = std::index_sequence_for<Ts...>;
+
+ public:
+  using value_type = std::tuple<Ts...>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = std::tuple<Ts&...>;
+  using const_reference = std::tuple<const Ts&...>;
+  using iterator = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+  using growth_policy = Growth;
+
+  template <std::size_t I>
+  using field_type = std::tuple_element_t<I, value_type>;
+
+  static constexpr std::size_t field_count = sizeof...(Ts);
+
+  basic_soa_vec() noexcept = default;
+
+  basic_soa_vec(const basic_soa_vec& other) {
+    // No destructor runs for a constructor that throws, so free the rows
+    // and columns built so far here.
+    try {
+      reserve(other._size);
+      for (size_type i = 0; i < other._size; ++i) {
+        construct_row(i, other[i]);
+        ++_size;
+      }
+    } catch (...) {
+      release_storage();
+      throw;
+    }
+  }
+
+  basic_soa_vec(basic_soa_vec&& other) noexcept
+      : _columns(std::exchange(other._columns, {})),
+        _size(std::exchange(other._size, 0)),
+        _capacity(std::exchange(other._capacity, 0)) {}
+
+  ~basic_soa_vec() {
+    release_storage();
+  }
+
+  auto operator=(const basic_soa_vec& other) -> basic_soa_vec& {
+    if (this != &other) {
+      basic_soa_vec copy(other);
+      swap(copy);
+    }
+    return *this;
+  }
+
+  auto operator=(basic_soa_vec&& other) noexcept -> basic_soa_vec& {
+    if (this != &other) {
+      release_storage();
+      _columns = std::exchange(other._columns, {});
+      _size = std::exchange(other._size, 0);
+      _capacity = std::exchange(other._capacity, 0);
+    }
+    return *this;
+  }
+
+  // Field I of every element, in order.
+  template <std::size_t I>
+  auto column() noexcept -> std::span<field_type<I>> {
+    return {std::get<I>(_columns), _size};
+  }
+
+  template <std::size_t I>
+  auto column() const noexcept -> std::span<const field_type<I>> {
+    return {std::get<I>(_columns), _size};
+  }
+
+  auto operator[](size_type pos) noexcept -> reference {
+    return row<reference>(pos, indices{});
+  }
+
+  auto operator[](size_type pos) const noexcept -> const_reference {
+    return row<const_reference>(pos, indices{});
+  }
+
+  auto at(size_type pos) -> reference {
+    check(pos);
+    return (*this)[pos];
+  }
+
+  auto at(size_type pos) const -> const_reference {
+    check(pos);
+    return (*this)[pos];
+  }
+
+  auto front() noexcept -> reference {
+    return (*this)[0];
+  }
+
+  auto front() const noexcept -> const_reference {
+    return (*this)[0];
+  }
+
+  auto back() noexcept -> reference {
+    return (*this)[_size - 1];
+  }
+
+  auto back() const noexcept -> const_reference {
+    return (*this)[_size - 1];
+  }
+
+  auto begin() noexcept -> iterator {
+    return iterator(this, 0);
+  }
+
+  auto begin() const noexcept -> const_iterator {
+    return const_iterator(this, 0);
+  }
+
+  auto end() noexcept -> iterator {
+    return iterator(this, _size);
+  }
+
+  auto end() const noexcept -> const_iterator {
+    return const_iterator(this, _size);
+  }
+
+  auto empty() const noexcept -> bool {
+    return _size == 0;
+  }
+
+  auto size() const noexcept -> size_type {
+    return _size;
+  }
+
+  auto capacity() const noexcept -> size_type {
+    return _capacity;
+  }
+
+  auto reserve(size_type new_cap) -> void {
+    if (new_cap > _capacity) {
+      reallocate(new_cap);
+    }
+  }
+
+  auto shrink_to_fit() -> void {
+    if (_size < _capacity) {
+      reallocate(_size);
+    }
+  }
+
+  auto clear() noexcept -> void {
+    destroy_rows(0, _size);
+    _size = 0;
+  }
+
+  auto push_back(const value_type& value) -> void {
+    std::apply([this](const Ts&... fields) { emplace_back(fields...); },
+               value);
+  }
+
+  auto push_back(value_type&& value) -> void {
+    std::apply(
+        [this](Ts&... fields) { emplace_back(std::move(fields)...); },
+        value);
+  }
+
+  // Appends an element whose field I is constructed from args...[I].
+  template <typename... Args>
+    requires(sizeof...(Args) == sizeof...(Ts) &&
+             (std::constructible_from<Ts, Args> && ...))
+  auto emplace_back(Args&&... args) -> void {
+    if (_size == _capacity) [[unlikely]] {
+      // args may refer into the columns; build the fields before growing.
+      value_type fields(std::forward<Args>(args)...);
+      grow(_size + 1);
+      construct_row(_size, std::move(fields));
+    } else {
+      construct_row(_size,
+                    std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+    ++_size;
+  }
+
+  auto pop_back() -> void {
+    if (_size > 0) {
+      --_size;
+      destroy_rows(_size, _size + 1);
+    }
+  }
+
+  // Shrinks to count elements or appends value-initialized ones.
+  auto resize(size_type count) -> void {
+    if (count > _size) {
+      reserve(count);
+      while (_size < count) {
+        construct_row(_size, std::tuple<Ts...>());
+        ++_size;
+      }
+    } else {
+      destroy_rows(count, _size);
+      _size = count;
+    }
+  }
+
+  // Erases pos in O(1) by moving the last element into its place. Does not
+  // preserve the order of the remaining elements.
+  auto swap_remove(const_iterator pos) -> iterator {
+    size_type hole = pos - begin();
+    if (hole != _size - 1) {
+      std::apply(
+          [&](auto*... columns) {
+            ((columns[hole] = std::move(columns[_size - 1])), ...);
+          },
+          _columns);
+    }
+    pop_back();
+    return begin() + hole;
+  }
+
+  auto swap(basic_soa_vec& other) noexcept -> void {
+    std::swap(_columns, other._columns);
+    std::swap(_size, other._size);
+    std::swap(_capacity, other._capacity);
+  }
+
+  friend auto operator==(const basic_soa_vec& lhs,
+                         const basic_soa_vec& rhs) -> bool {
+    return lhs._size == rhs._size &&
+           [&]<std::size_t... I>(std::index_sequence<I...>) {
+             return (std::equal(std::get<I>(lhs._columns),
+                                std::get<I>(lhs._columns) + lhs._size,
+                                std::get<I>(rhs._columns)) &&
+                     ...);
+           }(indices{});
+  }
+
+ private:
+  template <typename T>
+  using column_allocator = stl::allocator<T, cache_line_size>;
+
+  auto check(size_type pos) const -> void {
+    if (pos >= _size) {
+      throw std::out_of_range(std::format(
+          "soa_vec::at: position {} out of range {}", pos, _size));
+    }
+  }
+
+  template <typename Row, std::size_t... I>
+  auto row(size_type pos, std::index_sequence<I...>) const noexcept -> Row {
+    return Row(std::get<I>(_columns)[pos]...);
+  }
+
+  // Constructs field I of row pos from std::get<I>(fields) for every I,
+  // destroying the fields already built if one throws.
+  template <typename Fields>
+  auto construct_row(size_type pos, Fields&& fields) -> void {
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+      std::size_t built = 0;
+      try {
+        ((std::construct_at(std::get<I>(_columns) + pos,
+                            std::get<I>(std::forward<Fields>(fields))),
+          ++built),
+         ...);
+      } catch (...) {
+        ((I < built ? std::destroy_at(std::get<I>(_columns) + pos) : void()),
+         ...);
+        throw;
+      }
+    }(indices{});
+  }
+
+  auto destroy_rows(size_type first, size_type last) noexcept -> void {
+    std::apply(
+        [&](auto*... columns) {
+          (std::destroy(columns + first, columns + last), ...);
+        },
+        _columns);
+  }
+
+  auto grow(size_type required) -> void {
+    reserve(growth_policy::next_capacity(_capacity, required,
+                                         (sizeof(Ts) + ...)));
+  }
+
+  auto release_storage() noexcept -> void {
+    clear();
+    std::apply(
+        [&](auto*... columns) { (deallocate(columns, _capacity), ...); },
+        _columns);
+    _columns = {};
+    _capacity = 0;
+  }
+
+  template <typename T>
+  static auto deallocate(T* column, size_type count) noexcept -> void {
+    if (column) {
+      column_allocator<T>{}.deallocate(column, count);
+    }
+  }
+
+  // Allocates every new column first, so that an allocation failure leaves
+  // the vector untouched, then moves the elements over; the moves cannot
+  // throw.
+  auto reallocate(size_type new_cap) -> void {
+    std::tuple<Ts*...> fresh{};
+    if (new_cap != 0) {
+      [&]<std::size_t... I>(std::index_sequence<I...>) {
+        try {
+          ((std::get<I>(fresh) =
+                column_allocator<Ts>{}.allocate(new_cap)),
+           ...);
+        } catch (...) {
+          (deallocate(std::get<I>(fresh), new_cap), ...);
+          throw;
+        }
+      }(indices{});
+    }
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+      (transfer(std::get<I>(_columns), _size, std::get<I>(fresh)), ...);
+      (deallocate(std::get<I>(_columns), _capacity), ...);
+    }(indices{});
+    _columns = fresh;
+    _capacity = new_cap;
+  }
+
+  template <typename T>
+  static auto transfer(T* first, size_type count, T* dest) noexcept -> void {
+    if (count != 0) {
+      stl::relocate_n(first, count, dest);
+    }
+  }
+
+  template <bool Const>
+  class basic_iterator {
+    using owner = std::conditional_t<Const, const basic_soa_vec, basic_soa_vec>;
+
+   public:
+    using iterator_concept = std::random_access_iterator_tag;
+    // Dereferencing yields a tuple of references rather than a true
+    // reference, so legacy algorithms may only treat this as an input
+    // iterator.
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::tuple<Ts...>;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::conditional_t<Const,
+                                         std::tuple<const Ts&...>,
+                                         std::tuple<Ts&...>>;
+
+    basic_iterator() noexcept = default;
+
+    basic_iterator(owner* vec, size_type pos) noexcept
+        : _vec(vec), _pos(pos) {}
+
+    operator basic_iterator<true>() const noexcept
+      requires(!Const)
+    {
+      return basic_iterator<true>(_vec, _pos);
+    }
+
+    auto operator*() const noexcept -> reference {
+      return (*_vec)[_pos];
+    }
+
+    auto operator[](difference_type offset) const noexcept -> reference {
+      return (*_vec)[_pos + offset];
+    }
+
+    auto operator++() noexcept -> basic_iterator& {
+      ++_pos;
+      return *this;
+    }
+
+    auto operator++(int) noexcept -> basic_iterator {
+      return basic_iterator(_vec, _pos++);
+    }
+
+    auto operator--() noexcept -> basic_iterator& {
+      --_pos;
+      return *this;
+    }
+
+    auto operator--(int) noexcept -> basic_iterator {
+      return basic_iterator(_vec, _pos--);
+    }
+
+    auto operator+=(difference_type offset) noexcept -> basic_iterator& {
+      _pos += offset;
+      return *this;
+    }
+
+    auto operator-=(difference_type offset) noexcept -> basic_iterator& {
+      _pos -= offset;
+      return *this;
+    }
+
+    friend auto operator+(basic_iterator it, difference_type offset) noexcept
+        -> basic_iterator {
+      return it += offset;
+    }
+
+    friend auto operator+(difference_type offset, basic_iterator it) noexcept
+        -> basic_iterator {
+      return it += offset;
+    }
+
+    friend auto operator-(basic_iterator it, difference_type offset) noexcept
+        -> basic_iterator {
+      return it -= offset;
+    }
+
+    friend auto operator-(const basic_iterator& lhs,
+                          const basic_iterator& rhs) noexcept
+        -> difference_type {
+      return static_cast<difference_type>(lhs._pos) -
+             static_cast<difference_type>(rhs._pos);
+    }
+
+    friend auto operator==(const basic_iterator& lhs,
+                           const basic_iterator& rhs) noexcept -> bool {
+      return lhs._pos == rhs._pos;
+    }
+
+    friend auto operator<=>(const basic_iterator& lhs,
+                            const basic_iterator& rhs) noexcept {
+      return lhs._pos <=> rhs._pos;
+    }
+
+   private:
+    owner* _vec{nullptr};
+    size_type _pos{0};
+  };
+
+  std::tuple<Ts*...> _columns{};
+  size_type _size{0};
+  size_type _capacity{0};
+};
+
+template <typename... Ts>
+using soa_vec = basic_soa_vec<doubling_growth, Ts...>;
+
+}  // namespace stl
@@ -0,0 +1,432 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <format>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "box.hpp"
+#include "vec.hpp"
+
+namespace stl {
+
+// Default chunk length: a power of two filling about 4 KiB.
+template <typename T>
+inline constexpr std::size_t default_chunk_size =
+    std::bit_floor(std::max<std::size_t>(1, 4096 / sizeof(T)));
+
+// Double-ended sequence that never relocates its elements. Storage is a vec
+// of boxed, fixed-size chunks; growth only allocates new chunks and moves the
+// chunk handles, so pointers and references to elements stay valid until the
+// element itself is removed. Indexing is a shift and a mask into the chunk
+// map. Chunks emptied by pops are kept as spares and reused by later pushes
+// at either end; shrink_to_fit() releases them.
+template <typename T, std::size_t ChunkSize = default_chunk_size<T>>
+class stable_vec {
+  static_assert(std::has_single_bit(ChunkSize),
+                "stable_vec: ChunkSize must be a power of two");
+
+  template <bool Const>
+  class basic_iterator;
+
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
+  using iterator = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  static constexpr size_type chunk_size = ChunkSize;
+
+  stable_vec() noexcept = default;
+
+  stable_vec(std::initializer_list<T> init) {
+    for (const auto& value : init) {
+      emplace_back(value);
+    }
+  }
+
+  stable_vec(const stable_vec& other) {
+    for (const auto& value : other) {
+      emplace_back(value);
+    }
+  }
+
+  stable_vec(stable_vec&& other) noexcept
+      : _chunks(std::move(other._chunks)),
+        _start(std::exchange(other._start, 0)),
+        _size(std::exchange(other._size, 0)) {}
+
+  ~stable_vec() {
+    clear();
+  }
+
+  auto operator=(const stable_vec& other) -> stable_vec& {
+    if (this != &other) {
+      stable_vec copy(other);
+      swap(copy);
+    }
+    return *this;
+  }
+
+  auto operator=(stable_vec&& other) noexcept -> stable_vec& {
+    if (this != &other) {
+      clear();
+      _chunks = std::move(other._chunks);
+      _start = std::exchange(other._start, 0);
+      _size = std::exchange(other._size, 0);
+    }
+    return *this;
+  }
+
+  auto at(size_type pos) -> reference {
+    check(pos);
+    return *slot(_start + pos);
+  }
+
+  auto at(size_type pos) const -> const_reference {
+    check(pos);
+    return *slot(_start + pos);
+  }
+
+  auto operator[](size_type pos) -> reference {
+    return *slot(_start + pos);
+  }
+
+  auto operator[](size_type pos) const -> const_reference {
+    return *slot(_start + pos);
+  }
+
+  auto front() -> reference {
+    return (*this)[0];
+  }
+
+  auto front() const -> const_reference {
+    return (*this)[0];
+  }
+
+  auto back() -> reference {
+    return (*this)[_size - 1];
+  }
+
+  auto back() const -> const_reference {
+    return (*this)[_size - 1];
+  }
+
+  auto begin() noexcept -> iterator {
+    return iterator(this, 0);
+  }
+
+  auto begin() const noexcept -> const_iterator {
+    return const_iterator(this, 0);
+  }
+
+  auto end() noexcept -> iterator {
+    return iterator(this, _size);
+  }
+
+  auto end() const noexcept -> const_iterator {
+    return const_iterator(this, _size);
+  }
+
+  auto rbegin() noexcept -> reverse_iterator {
+    return reverse_iterator(end());
+  }
+
+  auto rbegin() const noexcept -> const_reverse_iterator {
+    return const_reverse_iterator(end());
+  }
+
+  auto rend() noexcept -> reverse_iterator {
+    return reverse_iterator(begin());
+  }
+
+  auto rend() const noexcept -> const_reverse_iterator {
+    return const_reverse_iterator(begin());
+  }
+
+  auto empty() const noexcept -> bool {
+    return _size == 0;
+  }
+
+  auto size() const noexcept -> size_type {
+    return _size;
+  }
+
+  // Releases every chunk that holds no element.
+  auto shrink_to_fit() -> void {
+    size_type first = first_chunk();
+    size_type last = _size == 0 ? first : chunk_of(_start + _size - 1) + 1;
+    for (size_type k = 0; k < _chunks.size(); ++k) {
+      if (k < first || k >= last) {
+        _chunks[k].reset();
+      }
+    }
+    _chunks.erase(_chunks.begin() + last, _chunks.end());
+    _chunks.erase(_chunks.begin(), _chunks.begin() + first);
+    _chunks.shrink_to_fit();
+    _start = _size == 0 ? 0 : _start - first * ChunkSize;
+  }
+
+  // Destroys every element; the chunks are kept as spares.
+  auto clear() noexcept -> void {
+    for (size_type i = 0; i < _size; ++i) {
+      std::destroy_at(slot(_start + i));
+    }
+    _size = 0;
+  }
+
+  auto push_back(const T& value) -> reference {
+    return emplace_back(value);
+  }
+
+  auto push_back(T&& value) -> reference {
+    return emplace_back(std::move(value));
+  }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  auto emplace_back(Args&&... args) -> reference {
+    size_type position = _start + _size;
+    if (chunk_of(position) == _chunks.size()) {
+      grow_back();
+      position = _start + _size;
+    }
+    T* dest = std::construct_at(raw_slot(position),
+                                std::forward<Args>(args)...);
+    ++_size;
+    return *dest;
+  }
+
+  auto push_front(const T& value) -> reference {
+    return emplace_front(value);
+  }
+
+  auto push_front(T&& value) -> reference {
+    return emplace_front(std::move(value));
+  }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  auto emplace_front(Args&&... args) -> reference {
+    if (_start == 0 || _chunks.empty()) {
+      grow_front();
+    }
+    T* dest = std::construct_at(raw_slot(_start - 1),
+                                std::forward<Args>(args)...);
+    --_start;
+    ++_size;
+    return *dest;
+  }
+
+  auto pop_back() -> void {
+    std::destroy_at(slot(_start + _size - 1));
+    --_size;
+  }
+
+  auto pop_front() -> void {
+    std::destroy_at(slot(_start));
+    ++_start;
+    --_size;
+  }
+
+  auto swap(stable_vec& other) noexcept -> void {
+    _chunks.swap(other._chunks);
+    std::swap(_start, other._start);
+    std::swap(_size, other._size);
+  }
+
+  friend auto operator==(const stable_vec& lhs, const stable_vec& rhs)
+      -> bool {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+  }
+
+ private:
+  static constexpr size_type _shift = std::countr_zero(ChunkSize);
+  static constexpr size_type _mask = ChunkSize - 1;
+
+  // Raw, suitably aligned storage for one element.
+  struct storage {
+    alignas(T) std::byte bytes[sizeof(T)];
+  };
+
+  using chunk = box<storage[]>;
+
+  static constexpr auto chunk_of(size_type position) noexcept -> size_type {
+    return position >> _shift;
+  }
+
+  auto first_chunk() const noexcept -> size_type {
+    return chunk_of(_start);
+  }
+
+  // Positions count slots from the start of chunk 0 of the map.
+  auto raw_slot(size_type position) -> T* {
+    chunk& target = _chunks[chunk_of(position)];
+    if (!target) {
+      target = make_box_for_overwrite<storage[]>(ChunkSize);
+    }
+    return reinterpret_cast<T*>(target.get() + (position & _mask));
+  }
+
+  auto slot(size_type position) const noexcept -> T* {
+    return std::launder(reinterpret_cast<T*>(
+        _chunks[chunk_of(position)].get() + (position & _mask)));
+  }
+
+  auto check(size_type pos) const -> void {
+    if (pos >= _size) {
+      throw std::out_of_range(std::format(
+          "stable_vec::at: position {} out of range {}", pos, _size));
+    }
+  }
+
+  // Makes room for one more chunk after the map. Spare chunks in front of
+  // the elements are rotated to the back when they make up at least half of
+  // the map, so a queue cycles through the same chunks; otherwise the map
+  // grows.
+  auto grow_back() -> void {
+    size_type spare = first_chunk();
+    if (spare != 0 && 2 * spare >= _chunks.size()) {
+      std::rotate(_chunks.begin(), _chunks.begin() + spare, _chunks.end());
+      _start -= spare * ChunkSize;
+    } else {
+      _chunks.emplace_back();
+    }
+  }
+
+  // Makes room for one more chunk before the elements, rotating spare
+  // chunks from the back or doubling the map with empty slots in front.
+  auto grow_front() -> void {
+    size_type used = _size == 0 ? 0 : chunk_of(_start + _size - 1) + 1;
+    size_type spare = _chunks.size() - used;
+    if (spare == 0 || 2 * spare < _chunks.size()) {
+      size_type added = std::max<size_type>(1, _chunks.size());
+      _chunks.resize(_chunks.size() + added);
+      spare += added;
+    }
+    std::rotate(_chunks.begin(), _chunks.end() - spare, _chunks.end());
+    _start += spare * ChunkSize;
+  }
+
+  template <bool Const>
+  class basic_iterator {
+    using owner = std::conditional_t<Const, const stable_vec, stable_vec>;
+
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const T*, T*>;
+    using reference = std::conditional_t<Const, const T&, T&>;
+
+    basic_iterator() noexcept = default;
+
+    basic_iterator(owner* vec, size_type pos) noexcept
+        : _vec(vec), _pos(pos) {}
+
+    operator basic_iterator<true>() const noexcept
+      requires(!Const)
+    {
+      return basic_iterator<true>(_vec, _pos);
+    }
+
+    auto operator*() const noexcept -> reference {
+      return (*_vec)[_pos];
+    }
+
+    auto operator->() const noexcept -> pointer {
+      return &(*_vec)[_pos];
+    }
+
+    auto operator[](difference_type offset) const noexcept -> reference {
+      return (*_vec)[_pos + offset];
+    }
+
+    auto operator++() noexcept -> basic_iterator& {
+      ++_pos;
+      return *this;
+    }
+
+    auto operator++(int) noexcept -> basic_iterator {
+      return basic_iterator(_vec, _pos++);
+    }
+
+    auto operator--() noexcept -> basic_iterator& {
+      --_pos;
+      return *this;
+    }
+
+    auto operator--(int) noexcept -> basic_iterator {
+      return basic_iterator(_vec, _pos--);
+    }
+
+    auto operator+=(difference_type offset) noexcept -> basic_iterator& {
+      _pos += offset;
+      return *this;
+    }
+
+    auto operator-=(difference_type offset) noexcept -> basic_iterator& {
+      _pos -= offset;
+      return *this;
+    }
+
+    friend auto operator+(basic_iterator it, difference_type offset) noexcept
+        -> basic_iterator {
+      return it += offset;
+    }
+
+    friend auto operator+(difference_type offset, basic_iterator it) noexcept
+        -> basic_iterator {
+      return it += offset;
+    }
+
+    friend auto operator-(basic_iterator it, difference_type offset) noexcept
+        -> basic_iterator {
+      return it -= offset;
+    }
+
+    friend auto operator-(const basic_iterator& lhs,
+                          const basic_iterator& rhs) noexcept
+        -> difference_type {
+      return static_cast<difference_type>(lhs._pos) -
+             static_cast<difference_type>(rhs._pos);
+    }
+
+    friend auto operator==(const basic_iterator& lhs,
+                           const basic_iterator& rhs) noexcept -> bool {
+      return lhs._pos == rhs._pos;
+    }
+
+    friend auto operator<=>(const basic_iterator& lhs,
+                            const basic_iterator& rhs) noexcept {
+      return lhs._pos <=> rhs._pos;
+    }
+
+   private:
+    owner* _vec{nullptr};
+    size_type _pos{0};
+  };
+
+  vec<chunk> _chunks;
+  // Position of the first element, counted from the start of _chunks[0].
+  size_type _start{0};
+  size_type _size{0};
+};
+
+}  // namespace stl
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace stl {
+
+// Fixed-size pool of worker threads with one task deque per worker. A worker
+// pops its own deque from the back (most recently pushed, still warm in
+// cache) and, when that runs dry, steals from the front of the others.
+// Threads that wait on pool work help run it instead of blocking, so
+// parallel_for may be nested freely.
+class thread_pool {
+ public:
+  explicit thread_pool(std::size_t threads) : _queues(threads) {
+    for (auto& queue : _queues) {
+      queue = std::make_unique<worker_queue>();
+    }
+    _threads.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+      _threads.emplace_back([this, i] { worker_loop(i); });
+    }
+  }
+
+  thread_pool(const thread_pool&) = delete;
+
+  // Runs every queued task, then joins the workers.
+  ~thread_pool() {
+    {
+      std::lock_guard lock(_sleep_mutex);
+      _stop = true;
+    }
+    _wake.notify_all();
+    for (auto& thread : _threads) {
+      thread.join();
+    }
+  }
+
+  auto operator=(const thread_pool&) -> thread_pool& = delete;
+
+  // Process-wide pool with one worker per hardware thread beyond the caller.
+  static auto global() -> thread_pool& {
+    static thread_pool pool(
+        std::max<std::size_t>(std::thread::hardware_concurrency(), 1) - 1);
+    return pool;
+  }
+
+  // Number of worker threads.
+  auto size() const noexcept -> std::size_t {
+    return _threads.size();
+  }
+
+  // Threads that take part in parallel_for: the workers plus the caller.
+  auto concurrency() const noexcept -> std::size_t {
+    return size() + 1;
+  }
+
+  // Queues task for execution. From a worker it goes to that worker's own
+  // deque; from any other thread the deques are filled round-robin.
+  template <typename Task>
+  auto submit(Task&& task) -> void {
+    if (_queues.empty()) {
+      task();
+      return;
+    }
+    std::size_t target = _current == this
+                             ? _current_index
+                             : _next.fetch_add(1, std::memory_order_relaxed);
+    push(target % _queues.size(), std::forward<Task>(task));
+  }
+
+  // Splits [first, last) into at most concurrency() contiguous blocks of at
+  // least grain indices and calls body(begin, end) once per block. The caller
+  // runs the first block itself and block k is queued on worker k - 1, so
+  // repeated calls over the same range touch the same pages from the same
+  // threads unless a block is stolen. The first exception thrown by body is
+  // rethrown once every block has finished.
+  template <typename Body>
+  auto parallel_for(std::size_t first,
+                    std::size_t last,
+                    std::size_t grain,
+                    Body&& body) -> void {
+    std::size_t count = last > first ? last - first : 0;
+    std::size_t blocks =
+        std::min(concurrency(), count / std::max<std::size_t>(grain, 1));
+    if (blocks <= 1) {
+      if (count != 0) {
+        body(first, last);
+      }
+      return;
+    }
+
+    struct shared_state {
+      std::atomic<std::size_t> remaining;
+      std::mutex error_mutex;
+      std::exception_ptr error;
+    };
+    auto state = std::make_shared<shared_state>();
+    state->remaining.store(blocks, std::memory_order_relaxed);
+
+    auto run_block = [&body, first, count, blocks](std::size_t block) {
+      std::size_t begin = first + count * block / blocks;
+      std::size_t end = first + count * (block + 1) / blocks;
+      body(begin, end);
+    };
+    auto finish = [](shared_state& shared, std::exception_ptr error) {
+      if (error) {
+        std::lock_guard lock(shared.error_mutex);
+        if (!shared.error) {
+          shared.error = std::move(error);
+        }
+      }
+      if (shared.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        shared.remaining.notify_all();
+      }
+    };
+
+    for (std::size_t block = 1; block < blocks; ++block) {
+      push(block - 1, [state, run_block, finish, block] {
+        std::exception_ptr error;
+        try {
+          run_block(block);
+        } catch (...) {
+          error = std::current_exception();
+        }
+        finish(*state, std::move(error));
+      });
+    }
+
+    std::exception_ptr error;
+    try {
+      run_block(0);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    finish(*state, std::move(error));
+
+    std::size_t self = _current == this ? _current_index : _queues.size();
+    while (std::size_t left =
+               state->remaining.load(std::memory_order_acquire)) {
+      if (!try_run_one(self)) {
+        state->remaining.wait(left, std::memory_order_acquire);
+      }
+    }
+    if (state->error) {
+      std::rethrow_exception(state->error);
+    }
+  }
+
+ private:
+  struct worker_queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  template <typename Task>
+  auto push(std::size_t index, Task&& task) -> void {
+    if (_queues.empty()) {
+      task();
+      return;
+    }
+    {
+      std::lock_guard lock(_queues[index]->mutex);
+      _queues[index]->tasks.emplace_back(std::forward<Task>(task));
+    }
+    {
+      std::lock_guard lock(_sleep_mutex);
+      ++_pending;
+    }
+    _wake.notify_one();
+  }
+
+  // Runs one queued task: the newest from queue self (if self is a worker),
+  // otherwise the oldest from any other queue. Returns false if all queues
+  // were empty.
+  auto try_run_one(std::size_t self) -> bool {
+    std::function<void()> task;
+    if (self < _queues.size()) {
+      std::lock_guard lock(_queues[self]->mutex);
+      if (!_queues[self]->tasks.empty()) {
+        task = std::move(_queues[self]->tasks.back());
+        _queues[self]->tasks.pop_back();
+      }
+    }
+    for (std::size_t offset = 1; !task && offset <= _queues.size();
+         ++offset) {
+      std::size_t victim = (self + offset) % _queues.size();
+      std::lock_guard lock(_queues[victim]->mutex);
+      if (!_queues[victim]->tasks.empty()) {
+        task = std::move(_queues[victim]->tasks.front());
+        _queues[victim]->tasks.pop_front();
+      }
+    }
+    if (!task) {
+      return false;
+    }
+    {
+      std::lock_guard lock(_sleep_mutex);
+      --_pending;
+    }
+    task();
+    return true;
+  }
+
+  auto worker_loop(std::size_t index) -> void {
+    _current = this;
+    _current_index = index;
+    while (true) {
+      if (try_run_one(index)) {
+        continue;
+      }
+      std::unique_lock lock(_sleep_mutex);
+      _wake.wait(lock, [this] { return _stop || _pending > 0; });
+      if (_stop && _pending == 0) {
+        return;
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<worker_queue>> _queues;
+  std::vector<std::thread> _threads;
+  std::mutex _sleep_mutex;
+  std::condition_variable _wake;
+  std::size_t _pending{0};
+  bool _stop{false};
+  std::atomic<std::size_t> _next{0};
+
+  static inline thread_local thread_pool* _current = nullptr;
+  static inline thread_local std::size_t _current_index = 0;
+};
+
+}  // namespace stl
@@ -1,23 +1,44 @@
 #pragma once
 
 #include <algorithm>
+#include <compare>
 #include <concepts>
 #include <cstddef>
 #include <format>
+#include <functional>
 #include <initializer_list>
 #include <iterator>
 #include <memory>
+#include <ranges>
+#include <stdexcept>
 #include <type_traits>
 #include <utility>
 
-#include "box.hpp"
+#include "allocator.hpp"
+#include "buffer_ops.hpp"
+#include "growth.hpp"
+#include "instrument.hpp"
+#include "relocate.hpp"
+#include "simd.hpp"
+#include "thread_pool.hpp"
 
 namespace stl {
 
-template <typename T>
+template <typename T,
+          typename Allocator = stl::allocator<T>,
+          typename Growth = doubling_growth>
 class vec {
+  using alloc_traits = std::allocator_traits<Allocator>;
+
+  static_assert(std::is_same_v<typename alloc_traits::value_type, T>,
+                "vec: Allocator::value_type must match T");
+  static_assert(std::is_same_v<typename alloc_traits::pointer, T*>,
+                "vec: fancy allocator pointers are not supported");
+
  public:
   using value_type = T;
+  using allocator_type = Allocator;
+  using growth_policy = Growth;
   using size_type = std::size_t;
   using difference_type = std::ptrdiff_t;
   using reference = value_type&;
@@ -29,111 +50,169 @@ class vec {
   using reverse_iterator = std::reverse_iterator<iterator>;
   using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
-  vec() : _size(0), _capacity(0), _buffer(nullptr) {}
+  vec() noexcept(noexcept(Allocator())) : vec(Allocator()) {}
+
+  explicit vec(const Allocator& alloc) noexcept
+      : _alloc(alloc), _size(0), _capacity(0), _buffer(nullptr) {}
 
-  explicit vec(size_type count)
-      : _size(count), _capacity(count), _buffer(stl::make_box<T[]>(count)) {
-    std::uninitialized_default_construct_n(_buffer.get(), count);
+  explicit vec(size_type count, const Allocator& alloc = Allocator())
+      : vec(alloc) {
+    _buffer = allocate(count);
+    _capacity = count;
+    ops::value_construct_n(_alloc, _buffer, count);
+    _size = count;
   }
 
-  vec(size_type count, const T& value)
+  vec(size_type count, const T& value, const Allocator& alloc = Allocator())
     requires std::copyable<T>
-      : _size(count), _capacity(count), _buffer(stl::make_box<T[]>(count)) {
-    std::uninitialized_fill_n(_buffer.get(), count, value);
+      : vec(alloc) {
+    _buffer = allocate(count);
+    _capacity = count;
+    if (parallel_init(count)) {
+      thread_pool::global().parallel_for(
+          0, count, _parallel_init_grain,
+          [this, &value](size_type begin, size_type end) {
+            ops::fill_construct_n(_alloc, _buffer + begin, end - begin, value);
+          });
+    } else {
+      ops::fill_construct_n(_alloc, _buffer, count, value);
+    }
+    _size = count;
   }
 
   vec(const vec& other)
-      : _size(other._size),
-        _capacity(other._size),
-        _buffer(stl::make_box<T[]>(other._size)) {
-    std::uninitialized_copy_n(other._buffer.get(), other._size, _buffer.get());
+      : vec(other, alloc_traits::select_on_container_copy_construction(
+                       other._alloc)) {}
+
+  vec(const vec& other, const Allocator& alloc) : vec(alloc) {
+    _buffer = allocate(other._size);
+    _capacity = other._size;
+    if (parallel_init(other._size)) {
+      thread_pool::global().parallel_for(
+          0, other._size, _parallel_init_grain,
+          [this, &other](size_type begin, size_type end) {
+            ops::copy_construct_n(_alloc, other._buffer + begin, end - begin,
+                             _buffer + begin);
+          });
+    } else {
+      ops::copy_construct_n(_alloc, other._buffer, other._size, _buffer);
+    }
+    _size = other._size;
   }
 
   vec(vec&& other) noexcept
-      : _size(std::exchange(other._size, 0)),
+      : _alloc(std::move(other._alloc)),
+        _size(std::exchange(other._size, 0)),
         _capacity(std::exchange(other._capacity, 0)),
-        _buffer(std::move(other._buffer)) {}
+        _buffer(std::exchange(other._buffer, nullptr)) {}
+
+  vec(vec&& other, const Allocator& alloc) : vec(alloc) {
+    if (_alloc == other._alloc) {
+      steal(other);
+    } else {
+      _buffer = allocate(other._size);
+      _capacity = other._size;
+      ops::move_construct_n(_alloc, other._buffer, other._size, _buffer);
+      _size = other._size;
+    }
+  }
 
-  vec(std::initializer_list<T> init)
+  vec(std::initializer_list<T> init, const Allocator& alloc = Allocator())
     requires std::copyable<T>
-      : _size(init.size()),
-        _capacity(init.size()),
-        _buffer(stl::make_box<T[]>(init.size())) {
-    std::uninitialized_copy(init.begin(), init.end(), _buffer.get());
-  }
+      : vec(init.begin(), init.end(), alloc) {}
 
   template <typename Iterator>
-  vec(Iterator first, Iterator last)
+  vec(Iterator first, Iterator last, const Allocator& alloc = Allocator())
     requires std::input_iterator<Iterator> &&
                  std::constructible_from<
                      T,
-                     typename std::iterator_traits<Iterator>::value_type>
-      : _size(std::distance(first, last)),
-        _capacity(_size),
-        _buffer(stl::make_box<T[]>(_size)) {
-    std::uninitialized_copy(first, last, _buffer.get());
+                     typename std::iterator_traits<Iterator>::reference>
+      : vec(alloc) {
+    assign(first, last);
   }
 
   ~vec() {
     clear();
+    deallocate(_buffer, _capacity);
   }
 
   auto operator=(const vec& other) -> vec& {
     if (this != &other) {
-      clear();
-      if (other._size > _capacity) {
-        _buffer = stl::make_box<T[]>(other._size);
-        _capacity = other._size;
+      if constexpr (alloc_traits::propagate_on_container_copy_assignment::
+                        value) {
+        if (_alloc != other._alloc) {
+          release_storage();
+        }
+        _alloc = other._alloc;
       }
-      std::uninitialized_copy_n(other._buffer.get(), other._size,
-                                _buffer.get());
-      _size = other._size;
+      assign(other.begin(), other.end());
     }
     return *this;
   }
 
-  auto operator=(vec&& other) noexcept -> vec& {
+  auto operator=(vec&& other) noexcept(
+      alloc_traits::propagate_on_container_move_assignment::value ||
+      alloc_traits::is_always_equal::value) -> vec& {
     if (this != &other) {
-      clear();
-      _buffer.reset();
-      _buffer = std::move(other._buffer);
-      _size = std::exchange(other._size, 0);
-      _capacity = std::exchange(other._capacity, 0);
+      if constexpr (alloc_traits::propagate_on_container_move_assignment::
+                        value) {
+        release_storage();
+        _alloc = std::move(other._alloc);
+        steal(other);
+      } else if (_alloc == other._alloc) {
+        release_storage();
+        steal(other);
+      } else {
+        assign(std::make_move_iterator(other.begin()),
+               std::make_move_iterator(other.end()));
+        other.clear();
+      }
     }
     return *this;
   }
 
   auto operator=(std::initializer_list<T> init) -> vec& {
-    clear();
-    if (init.size() > _capacity) {
-      _buffer = stl::make_box<T[]>(init.size());
-      _capacity = init.size();
-    }
-    std::uninitialized_copy(init.begin(), init.end(), _buffer.get());
-    _size = init.size();
+    assign(init.begin(), init.end());
     return *this;
   }
 
   auto assign(size_type count, const T& value) -> void {
     clear();
     if (count > _capacity) {
-      _buffer = stl::make_box<T[]>(count);
+      release_storage();
+      _buffer = allocate(count);
       _capacity = count;
     }
-    std::uninitialized_fill_n(_buffer.get(), count, value);
+    ops::fill_construct_n(_alloc, _buffer, count, value);
     _size = count;
   }
 
   template <typename InputIt>
+    requires std::input_iterator<InputIt>
   auto assign(InputIt first, InputIt last) -> void {
     clear();
-    size_type count = std::distance(first, last);
-    if (count > _capacity) {
-      _buffer = stl::make_box<T[]>(count);
-      _capacity = count;
+    if constexpr (std::forward_iterator<InputIt>) {
+      size_type count = std::distance(first, last);
+      if (count > _capacity) {
+        release_storage();
+        _buffer = allocate(count);
+        _capacity = count;
+      }
+      ops::copy_construct_n(_alloc, first, count, _buffer);
+      _size = count;
+    } else {
+      for (; first != last; ++first) {
+        emplace_back(*first);
+      }
     }
-    std::uninitialized_copy(first, last, _buffer.get());
-    _size = count;
+  }
+
+  auto assign(std::initializer_list<T> init) -> void {
+    assign(init.begin(), init.end());
+  }
+
+  auto get_allocator() const noexcept -> allocator_type {
+    return _alloc;
   }
 
   auto at(size_type pos) -> reference {
@@ -177,27 +256,27 @@ class vec {
   }
 
   auto data() noexcept -> pointer {
-    return _buffer.get();
+    return _buffer;
   }
 
   auto data() const noexcept -> const_pointer {
-    return _buffer.get();
+    return _buffer;
   }
 
   auto begin() noexcept -> iterator {
-    return _buffer.get();
+    return _buffer;
   }
 
   auto begin() const noexcept -> const_iterator {
-    return _buffer.get();
+    return _buffer;
   }
 
   auto end() noexcept -> iterator {
-    return _buffer.get() + _size;
+    return _buffer + _size;
   }
 
   auto end() const noexcept -> const_iterator {
-    return _buffer.get() + _size;
+    return _buffer + _size;
   }
 
   auto rbegin() noexcept -> reverse_iterator {
@@ -230,34 +309,18 @@ class vec {
 
   auto reserve(size_type new_cap) -> void {
     if (new_cap > _capacity) {
-      auto new_buffer = stl::make_box<T[]>(new_cap);
-      if constexpr (std::is_nothrow_move_constructible_v<T>) {
-        std::uninitialized_move_n(_buffer.get(), _size, new_buffer.get());
-      } else {
-        std::uninitialized_copy_n(_buffer.get(), _size, new_buffer.get());
-      }
-      std::destroy_n(_buffer.get(), _size);
-      _buffer = std::move(new_buffer);
-      _capacity = new_cap;
+      reallocate(new_cap, instrument::reallocation::reserve);
     }
   }
 
   auto shrink_to_fit() -> void {
     if (_size < _capacity) {
-      auto new_buffer = stl::make_box<T[]>(_size);
-      if constexpr (std::is_nothrow_move_constructible_v<T>) {
-        std::uninitialized_move_n(_buffer.get(), _size, new_buffer.get());
-      } else {
-        std::uninitialized_copy_n(_buffer.get(), _size, new_buffer.get());
-      }
-      std::destroy_n(_buffer.get(), _size);
-      _buffer = std::move(new_buffer);
-      _capacity = _size;
+      reallocate(_size, instrument::reallocation::shrink);
     }
   }
 
   auto clear() noexcept -> void {
-    std::destroy_n(_buffer.get(), _size);
+    ops::destroy_n(_alloc, _buffer, _size);
     _size = 0;
   }
 
@@ -265,9 +328,9 @@ class vec {
     requires std::copyable<T>
   {
     if (_size == _capacity) {
-      reserve(_capacity == 0 ? 1 : 2 * _capacity);
+      grow(_size + 1);
     }
-    new (_buffer.get() + _size) T(value);
+    alloc_traits::construct(_alloc, _buffer + _size, value);
     ++_size;
   }
 
@@ -275,9 +338,9 @@ class vec {
     requires std::movable<T>
   {
     if (_size == _capacity) {
-      reserve(_capacity == 0 ? 1 : 2 * _capacity);
+      grow(_size + 1);
     }
-    new (_buffer.get() + _size) T(std::move(value));
+    alloc_traits::construct(_alloc, _buffer + _size, std::move(value));
     ++_size;
   }
 
@@ -286,65 +349,425 @@ class vec {
     requires std::constructible_from<T, Args...>
   {
     if (_size == _capacity) {
-      reserve(_capacity == 0 ? 1 : 2 * _capacity);
+      grow(_size + 1);
     }
-    new (_buffer.get() + _size) T(std::forward<Args>(args)...);
+    alloc_traits::construct(_alloc, _buffer + _size,
+                            std::forward<Args>(args)...);
+    ++_size;
+    return back();
+  }
+
+  // Appends without checking capacity. The caller must have reserved room,
+  // i.e. size() < capacity().
+  auto unchecked_push_back(const T& value) -> void
+    requires std::copyable<T>
+  {
+    alloc_traits::construct(_alloc, _buffer + _size, value);
+    ++_size;
+  }
+
+  auto unchecked_push_back(T&& value) -> void
+    requires std::movable<T>
+  {
+    alloc_traits::construct(_alloc, _buffer + _size, std::move(value));
+    ++_size;
+  }
+
+  template <typename... Args>
+  auto unchecked_emplace_back(Args&&... args) -> reference
+    requires std::constructible_from<T, Args...>
+  {
+    alloc_traits::construct(_alloc, _buffer + _size,
+                            std::forward<Args>(args)...);
     ++_size;
     return back();
   }
 
+  // Appends count elements read from first, reserving once up front.
+  template <typename InputIt>
+    requires std::input_iterator<InputIt>
+  auto append_n(InputIt first, size_type count) -> void {
+    if (_size + count > _capacity) {
+      grow(_size + count);
+    }
+    ops::copy_construct_n(_alloc, first, count, _buffer + _size);
+    _size += count;
+  }
+
+  template <std::ranges::input_range Range>
+  auto append_range(Range&& range) -> void {
+    if constexpr (std::ranges::forward_range<Range> ||
+                  std::ranges::sized_range<Range>) {
+      auto count = static_cast<size_type>(std::ranges::distance(range));
+      append_n(std::ranges::begin(range), count);
+    } else {
+      for (auto&& value : range) {
+        emplace_back(std::forward<decltype(value)>(value));
+      }
+    }
+  }
+
+  template <typename... Args>
+  auto emplace(const_iterator pos, Args&&... args) -> iterator
+    requires std::constructible_from<T, Args...>
+  {
+    size_type index = pos - begin();
+    if (_size == _capacity || index == _size) {
+      // Neither path moves existing elements before the new one is built, so
+      // args may safely refer into this vec.
+      return insert_with(index, 1, [&](pointer slot) {
+        alloc_traits::construct(_alloc, slot, std::forward<Args>(args)...);
+      });
+    }
+    T value(std::forward<Args>(args)...);
+    return insert_with(index, 1, [&](pointer slot) {
+      alloc_traits::construct(_alloc, slot, std::move(value));
+    });
+  }
+
+  auto insert(const_iterator pos, const T& value) -> iterator
+    requires std::copyable<T>
+  {
+    return emplace(pos, value);
+  }
+
+  auto insert(const_iterator pos, T&& value) -> iterator
+    requires std::movable<T>
+  {
+    return emplace(pos, std::move(value));
+  }
+
+  auto insert(const_iterator pos, size_type count, const T& value) -> iterator
+    requires std::copyable<T>
+  {
+    size_type index = pos - begin();
+    if (std::less_equal<const T*>{}(data(), std::addressof(value)) &&
+        std::less<const T*>{}(std::addressof(value), data() + _size)) {
+      T copy(value);
+      return insert_with(index, count, [&](pointer slot) {
+        alloc_traits::construct(_alloc, slot, copy);
+      });
+    }
+    return insert_with(index, count, [&](pointer slot) {
+      alloc_traits::construct(_alloc, slot, value);
+    });
+  }
+
+  // Inserts [first, last) before pos. Forward ranges reserve once and shift
+  // the tail a single time; input ranges are appended and rotated into place.
+  template <typename InputIt>
+    requires std::input_iterator<InputIt>
+  auto insert(const_iterator pos, InputIt first, InputIt last) -> iterator {
+    size_type index = pos - begin();
+    if constexpr (std::forward_iterator<InputIt>) {
+      size_type count = std::distance(first, last);
+      return insert_with(index, count, [&](pointer slot) {
+        alloc_traits::construct(_alloc, slot, *first);
+        ++first;
+      });
+    } else {
+      size_type old_size = _size;
+      for (; first != last; ++first) {
+        emplace_back(*first);
+      }
+      std::rotate(begin() + index, begin() + old_size, end());
+      return begin() + index;
+    }
+  }
+
+  auto insert(const_iterator pos, std::initializer_list<T> init) -> iterator {
+    return insert(pos, init.begin(), init.end());
+  }
+
+  auto erase(const_iterator pos) -> iterator {
+    return erase(pos, pos + 1);
+  }
+
+  auto erase(const_iterator first, const_iterator last) -> iterator {
+    size_type index = first - begin();
+    size_type count = last - first;
+    if (count != 0) {
+      ops::erase_n(_alloc, _buffer, _size, index, count);
+      _size -= count;
+    }
+    return _buffer + index;
+  }
+
+  // Erases pos in O(1) by moving the last element into its place. Does not
+  // preserve the order of the remaining elements.
+  auto swap_remove(const_iterator pos) -> iterator {
+    size_type index = pos - begin();
+    ops::swap_remove(_alloc, _buffer, _size, index);
+    --_size;
+    return _buffer + index;
+  }
+
   auto pop_back() -> void {
     if (_size > 0) {
       --_size;
-      _buffer.get()[_size].~T();
+      alloc_traits::destroy(_alloc, _buffer + _size);
     }
   }
 
   auto resize(size_type count) -> void {
     if (count > _size) {
       reserve(count);
-      std::uninitialized_default_construct_n(_buffer.get() + _size,
-                                             count - _size);
+      ops::value_construct_n(_alloc, _buffer + _size, count - _size);
     } else if (count < _size) {
-      std::destroy_n(_buffer.get() + count, _size - count);
+      ops::destroy_n(_alloc, _buffer + count, _size - count);
     }
     _size = count;
   }
 
+  // Like resize, but new elements are default-initialized, so trivial types
+  // such as std::byte are left uninitialized rather than zeroed.
+  auto resize_for_overwrite(size_type count) -> void {
+    if (count > _size) {
+      reserve(count);
+      ops::default_construct_n(_alloc, _buffer + _size, count - _size);
+    } else if (count < _size) {
+      ops::destroy_n(_alloc, _buffer + count, _size - count);
+    }
+    _size = count;
+  }
+
+  // Grows the storage to count elements without initializing them and calls
+  // op(data(), count). op writes the buffer and returns how many leading
+  // elements it produced; the vec is then truncated to that size. Useful for
+  // reading straight from a file descriptor or socket.
+  template <typename Operation>
+    requires std::is_trivially_default_constructible_v<T> &&
+             std::is_trivially_destructible_v<T> &&
+             std::is_invocable_r_v<size_type, Operation&, pointer, size_type>
+  auto resize_and_overwrite(size_type count, Operation op) -> void {
+    reserve(count);
+    size_type written = std::move(op)(_buffer, count);
+    _size = std::min(written, count);
+  }
+
   auto resize(size_type count, const T& value) -> void {
     if (count > _size) {
       reserve(count);
-      std::uninitialized_fill_n(_buffer.get() + _size, count - _size, value);
+      ops::fill_construct_n(_alloc, _buffer + _size, count - _size, value);
     } else if (count < _size) {
-      std::destroy_n(_buffer.get() + count, _size - count);
+      ops::destroy_n(_alloc, _buffer + count, _size - count);
     }
     _size = count;
   }
 
   auto swap(vec& other) noexcept -> void {
+    if constexpr (alloc_traits::propagate_on_container_swap::value) {
+      std::swap(_alloc, other._alloc);
+    }
     std::swap(_size, other._size);
     std::swap(_capacity, other._capacity);
     std::swap(_buffer, other._buffer);
   }
 
+  auto find(const T& value) -> iterator {
+    if constexpr (simd::vectorizable<T>) {
+      return begin() + simd::find(data(), _size, value);
+    } else {
+      return std::find(begin(), end(), value);
+    }
+  }
+
+  auto find(const T& value) const -> const_iterator {
+    return const_cast<vec&>(*this).find(value);
+  }
+
+  auto count(const T& value) const -> size_type {
+    if constexpr (simd::vectorizable<T>) {
+      return simd::count(data(), _size, value);
+    } else {
+      return std::count(begin(), end(), value);
+    }
+  }
+
+  auto contains(const T& value) const -> bool {
+    return find(value) != end();
+  }
+
   auto operator==(const vec& other) const -> bool {
     if (_size != other._size) {
       return false;
     }
-    return std::equal(begin(), end(), other.begin());
+    if constexpr (simd::vectorizable<T>) {
+      return simd::equal(data(), other.data(), _size);
+    } else {
+      return std::equal(begin(), end(), other.begin());
+    }
   }
 
-  auto operator<=>(const vec& other) const -> std::strong_ordering
+  auto operator<=>(const vec& other) const
     requires std::three_way_comparable<T>
   {
-    return std::lexicographical_compare_three_way(begin(), end(), other.begin(),
-                                                  other.end());
+    using ordering = std::compare_three_way_result_t<T>;
+    if constexpr (simd::vectorizable<T>) {
+      size_type common = std::min(_size, other._size);
+      size_type pos = simd::mismatch(data(), other.data(), common);
+      if (pos != common) {
+        return ordering(_buffer[pos] <=> other._buffer[pos]);
+      }
+      return ordering(_size <=> other._size);
+    } else {
+      return ordering(std::lexicographical_compare_three_way(
+          begin(), end(), other.begin(), other.end()));
+    }
   }
 
  private:
+  using ops = detail::buffer_ops<T, Allocator>;
+
+  // Allocators that can resize a block in place (stl::allocator) let
+  // trivially relocatable elements grow without a separate copy.
+  static constexpr bool _can_reallocate =
+      is_trivially_relocatable_v<T> &&
+      requires(Allocator& alloc, T* ptr, size_type n) {
+        { alloc.reallocate(ptr, n, n) } -> std::same_as<T*>;
+      };
+
+  // Fill and copy construction of at least this many bytes of trivially
+  // copyable elements is split across thread_pool::global(). Besides using
+  // more memory bandwidth, this makes each pool thread the first to touch its
+  // slice of a fresh buffer, so on NUMA machines the pages are placed near the
+  // threads that stl::parallel algorithms later hand the same slices to.
+  static constexpr size_type _parallel_init_bytes = size_type{4} << 20;
+  static constexpr size_type _parallel_init_grain =
+      std::max<size_type>(1, (size_type{1} << 20) / sizeof(T));
+
+  static constexpr auto parallel_init(size_type count) noexcept -> bool {
+    return ops::plain_construct && std::is_trivially_copyable_v<T> &&
+           count >= _parallel_init_bytes / sizeof(T);
+  }
+
+  auto allocate(size_type count) -> pointer {
+    if (count == 0) {
+      return nullptr;
+    }
+    pointer ptr = alloc_traits::allocate(_alloc, count);
+    instrument::on_allocate<vec>(count * sizeof(T));
+    return ptr;
+  }
+
+  auto deallocate(pointer ptr, size_type count) noexcept -> void {
+    if (ptr) {
+      instrument::on_deallocate<vec>(count * sizeof(T));
+      alloc_traits::deallocate(_alloc, ptr, count);
+    }
+  }
+
+  // Reallocates to the capacity the growth policy picks for required slots.
+  auto grow(size_type required) -> void {
+    size_type new_cap = Growth::next_capacity(_capacity, required, sizeof(T));
+    if (new_cap > _capacity) {
+      reallocate(new_cap, instrument::reallocation::growth);
+    }
+  }
+
+  auto release_storage() noexcept -> void {
+    clear();
+    deallocate(_buffer, _capacity);
+    _buffer = nullptr;
+    _capacity = 0;
+  }
+
+  auto steal(vec& other) noexcept -> void {
+    _buffer = std::exchange(other._buffer, nullptr);
+    _size = std::exchange(other._size, 0);
+    _capacity = std::exchange(other._capacity, 0);
+  }
+
+  // Moves the live elements into freshly allocated storage of new_cap slots.
+  // reason only feeds the instrumentation counters.
+  auto reallocate(size_type new_cap, instrument::reallocation reason)
+      -> void {
+    if (_buffer) {
+      instrument::on_reallocate<vec>(reason, _size * sizeof(T));
+    }
+    if constexpr (_can_reallocate) {
+      if (_buffer && new_cap != 0) {
+        _buffer = _alloc.reallocate(_buffer, _capacity, new_cap);
+        instrument::on_deallocate<vec>(_capacity * sizeof(T));
+        instrument::on_allocate<vec>(new_cap * sizeof(T));
+        _capacity = new_cap;
+        return;
+      }
+    }
+    pointer new_buffer = allocate(new_cap);
+    try {
+      ops::transfer_n(_alloc, _buffer, _size, new_buffer);
+    } catch (...) {
+      deallocate(new_buffer, new_cap);
+      throw;
+    }
+    ops::release_transferred(_alloc, _buffer, _size);
+    deallocate(_buffer, _capacity);
+    _buffer = new_buffer;
+    _capacity = new_cap;
+  }
+
+  // Opens a gap of count slots at index, fills it by calling make(slot) for
+  // each slot and returns an iterator to the first new element.
+  template <typename Make>
+  auto insert_with(size_type index, size_type count, Make make) -> iterator {
+    if (count == 0) {
+      return _buffer + index;
+    }
+    if (_size + count > _capacity) {
+      size_type new_cap =
+          Growth::next_capacity(_capacity, _size + count, sizeof(T));
+      if (_buffer) {
+        instrument::on_reallocate<vec>(instrument::reallocation::growth,
+                                       _size * sizeof(T));
+      }
+      pointer new_buffer = allocate(new_cap);
+      try {
+        ops::insert_into(_alloc, _buffer, _size, index, count, new_buffer,
+                         make);
+      } catch (...) {
+        deallocate(new_buffer, new_cap);
+        throw;
+      }
+      ops::release_transferred(_alloc, _buffer, _size);
+      deallocate(_buffer, _capacity);
+      _buffer = new_buffer;
+      _capacity = new_cap;
+    } else {
+      ops::insert_in_place(_alloc, _buffer, _size, index, count, make);
+    }
+    _size += count;
+    return _buffer + index;
+  }
+
+  [[no_unique_address]] allocator_type _alloc;
   size_type _size;
   size_type _capacity;
-  stl::box<T[]> _buffer;
+  pointer _buffer;
 };
 
+// Stateless allocators carry no address-dependent state, so a vec that uses
+// one is just a pointer and two counters.
+template <typename T, typename Allocator, typename Growth>
+struct is_trivially_relocatable<vec<T, Allocator, Growth>>
+    : std::bool_constant<std::is_empty_v<Allocator> ||
+                         is_trivially_relocatable_v<Allocator>> {};
+
+// vec whose buffer starts on an Align-byte boundary.
+template <typename T, std::size_t Align = cache_line_size>
+using aligned_vec = vec<T, aligned_allocator<T, Align>>;
+
+// Removes every element matching pred in a single compacting pass.
+template <typename T, typename Allocator, typename Growth, typename Pred>
+auto erase_if(vec<T, Allocator, Growth>& values, Pred pred) ->
+    typename vec<T, Allocator, Growth>::size_type {
+  return detail::erase_if_compacting(values, pred);
+}
+
+template <typename T, typename Allocator, typename Growth, typename U>
+auto erase(vec<T, Allocator, Growth>& values, const U& value) ->
+    typename vec<T, Allocator, Growth>::size_type {
+  return erase_if(values, [&](const T& element) { return element == value; });
+}
+
 }  // namespace stl